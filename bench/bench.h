@@ -0,0 +1,84 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pmt::bench {
+
+using Metrics = std::vector<std::pair<std::string, double>>;
+
+/* runs registered cases and prints one JSON object per line to out */
+class Runner {
+public:
+    Runner(FILE* out, std::string filter, double min_ms)
+        : out_(out), filter_(std::move(filter)), min_ms_(min_ms) {}
+
+    bool enabled(const std::string& name) const {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    /* times fn in doubling batches until one lasts min_ms/5, then keeps the fastest of
+       five such batches; fn returns a value that is folded into a sink so the work
+       can't be optimized away */
+    template <typename Fn>
+    double measure(Fn&& fn, uint64_t& iters) {
+        using clock = std::chrono::steady_clock;
+        sink_ += static_cast<uint64_t>(fn());
+
+        uint64_t batch = 1;
+        double batch_ms = 0;
+        for (;;) {
+            auto start = clock::now();
+            for (uint64_t i = 0; i < batch; ++i) sink_ += static_cast<uint64_t>(fn());
+            batch_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            if (batch_ms >= min_ms_ / 5 || batch >= (uint64_t(1) << 30)) break;
+            batch *= 2;
+        }
+
+        double best_ns = batch_ms * 1e6 / static_cast<double>(batch);
+        iters = batch;
+        for (int round = 1; round < 5; ++round) {
+            auto start = clock::now();
+            for (uint64_t i = 0; i < batch; ++i) sink_ += static_cast<uint64_t>(fn());
+            double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            best_ns = std::min(best_ns, ms * 1e6 / static_cast<double>(batch));
+            iters += batch;
+        }
+        return best_ns;
+    }
+
+    template <typename Fn>
+    void run(const std::string& name, Fn&& fn, const Metrics& extra = {}) {
+        if (!enabled(name)) return;
+        uint64_t iters = 0;
+        double ns = measure(fn, iters);
+        Metrics m = {{"iters", static_cast<double>(iters)}, {"ns_per_op", ns}};
+        m.insert(m.end(), extra.begin(), extra.end());
+        report(name, m);
+    }
+
+    void report(const std::string& name, const Metrics& metrics) {
+        fprintf(out_, "{\"bench\":\"%s\"", name.c_str());
+        for (const auto& [key, value] : metrics)
+            fprintf(out_, ",\"%s\":%.6g", key.c_str(), value);
+        fprintf(out_, "}\n");
+        fflush(out_);
+    }
+
+    void note(const std::string& name, const std::string& message) {
+        fprintf(out_, "{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", name.c_str(), message.c_str());
+        fflush(out_);
+    }
+
+private:
+    FILE* out_;
+    std::string filter_;
+    double min_ms_;
+    volatile uint64_t sink_ = 0;
+};
+
+}
@@ -0,0 +1,288 @@
+#include "fixtures.h"
+#include "aur_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace pmt::bench {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const WORDS[] = {
+    "fast", "library", "for", "the", "terminal", "client", "git", "bindings", "python",
+    "rust", "tool", "viewer", "daemon", "plugin", "qt", "gtk", "wayland", "fonts",
+    "themes", "driver", "audio", "video", "network", "manager", "utility", "modern",
+};
+
+std::string words(Rng& rng, int n) {
+    std::string out;
+    for (int i = 0; i < n; ++i) {
+        if (i) out += ' ';
+        out += WORDS[rng.below(static_cast<int>(sizeof(WORDS) / sizeof(WORDS[0])))];
+    }
+    return out;
+}
+
+std::string pkg_name(Rng& rng, int i) {
+    return std::string(WORDS[rng.below(26)]) + "-" + WORDS[rng.below(26)] + "-" + std::to_string(i);
+}
+
+std::string version(Rng& rng) {
+    return std::to_string(rng.below(20)) + "." + std::to_string(rng.below(100)) + "." +
+           std::to_string(rng.below(10)) + "-" + std::to_string(1 + rng.below(3));
+}
+
+void json_strings(std::string& out, const std::vector<std::string>& items) {
+    out += '[';
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i) out += ',';
+        out += '"' + items[i] + '"';
+    }
+    out += ']';
+}
+
+/* ustar header plus body, padded to the 512-byte block size */
+void tar_entry(std::string& out, const std::string& name, const std::string& body, bool dir) {
+    char h[512];
+    memset(h, 0, sizeof(h));
+    snprintf(h, 100, "%s", name.c_str());
+    snprintf(h + 100, 8, "%07o", dir ? 0755 : 0644);
+    snprintf(h + 108, 8, "%07o", 0);
+    snprintf(h + 116, 8, "%07o", 0);
+    snprintf(h + 124, 12, "%011o", static_cast<unsigned>(dir ? 0 : body.size()));
+    snprintf(h + 136, 12, "%011o", 1700000000u);
+    h[156] = dir ? '5' : '0';
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+    memset(h + 148, ' ', 8);
+    unsigned sum = 0;
+    for (unsigned char c : h) sum += c;
+    snprintf(h + 148, 8, "%06o", sum);
+    h[155] = ' ';
+    out.append(h, sizeof(h));
+    if (dir) return;
+    out += body;
+    out.append((512 - body.size() % 512) % 512, '\0');
+}
+
+void desc_field(std::string& out, const char* key, const std::string& value) {
+    out += '%';
+    out += key;
+    out += "%\n" + value + "\n\n";
+}
+
+}
+
+std::string aur_response(int count, bool info, uint64_t seed) {
+    Rng rng(seed);
+    std::string out = "{\"resultcount\":" + std::to_string(count) + ",\"results\":[";
+    for (int i = 0; i < count; ++i) {
+        if (i) out += ',';
+        std::string name = pkg_name(rng, i);
+        out += "{\"Description\":\"" + words(rng, 6 + rng.below(10)) + "\"";
+        out += ",\"FirstSubmitted\":" + std::to_string(1400000000 + rng.below(300000000));
+        out += ",\"ID\":" + std::to_string(100000 + i);
+        out += ",\"LastModified\":" + std::to_string(1600000000 + rng.below(100000000));
+        out += ",\"Maintainer\":\"" + std::string(WORDS[rng.below(26)]) + "\"";
+        out += ",\"Name\":\"" + name + "\"";
+        out += ",\"NumVotes\":" + std::to_string(rng.below(3000));
+        out += ",\"OutOfDate\":" + std::string(rng.below(10) == 0 ? "1700000000" : "null");
+        out += ",\"PackageBase\":\"" + name + "\"";
+        out += ",\"PackageBaseID\":" + std::to_string(100000 + i);
+        out += ",\"Popularity\":" + std::to_string(rng.below(10000) / 100.0);
+        out += ",\"URL\":\"https://github.com/" + name + "/" + name + "\"";
+        out += ",\"URLPath\":\"/cgit/aur.git/snapshot/" + name + ".tar.gz\"";
+        out += ",\"Version\":\"" + version(rng) + "\"";
+        if (info) {
+            std::vector<std::string> deps, makedeps;
+            for (int d = rng.below(8); d > 0; --d) deps.push_back(pkg_name(rng, rng.below(5000)));
+            for (int d = rng.below(4); d > 0; --d) makedeps.push_back(pkg_name(rng, rng.below(5000)));
+            out += ",\"Depends\":";
+            json_strings(out, deps);
+            out += ",\"MakeDepends\":";
+            json_strings(out, makedeps);
+            out += ",\"License\":[\"MIT\"],\"Keywords\":[\"" + std::string(WORDS[rng.below(26)]) + "\"]";
+        }
+        out += '}';
+    }
+    out += "],\"type\":\"";
+    out += info ? "multiinfo" : "search";
+    out += "\",\"version\":5}";
+    return out;
+}
+
+std::vector<PackageInfo> synthetic_packages(int count, uint64_t seed) {
+    Rng rng(seed);
+    std::vector<PackageInfo> out;
+    out.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        PackageInfo p;
+        p.name = pkg_name(rng, i);
+        p.version = version(rng);
+        p.description = words(rng, 6 + rng.below(10));
+        p.repo = i % 3 == 0 ? "extra" : "core";
+        p.url = "https://example.org/" + p.name;
+        p.arch = "x86_64";
+        p.licenses = {"GPL"};
+        for (int d = rng.below(6); d > 0; --d) p.depends.push_back(pkg_name(rng, rng.below(count)));
+        p.download_size = rng.below(50000000);
+        p.install_size = p.download_size * 3;
+        p.build_date = 1600000000 + rng.below(100000000);
+        p.installed = rng.below(4) == 0;
+        if (p.installed) p.installed_version = p.version;
+        out.push_back(std::move(p));
+    }
+    return out;
+}
+
+void pkgbuild_pair(int lines, int edits, std::vector<std::string>& old_lines,
+                   std::vector<std::string>& new_lines, uint64_t seed) {
+    Rng rng(seed);
+    old_lines.clear();
+    for (int i = 0; i < lines; ++i) {
+        switch (rng.below(6)) {
+            case 0: old_lines.push_back(""); break;
+            case 1: old_lines.push_back("}"); break;
+            case 2: old_lines.push_back("  cd \"$srcdir/$pkgname-$pkgver\""); break;
+            default: old_lines.push_back("  " + words(rng, 2 + rng.below(6)) + " " + std::to_string(i)); break;
+        }
+    }
+
+    new_lines = old_lines;
+    for (int e = 0; e < edits && !new_lines.empty(); ++e) {
+        size_t at = static_cast<size_t>(rng.below(static_cast<int>(new_lines.size())));
+        int span = 1 + rng.below(4);
+        switch (rng.below(3)) {
+            case 0:
+                for (int k = 0; k < span && at < new_lines.size(); ++k, ++at)
+                    new_lines[at] = "  " + words(rng, 4) + " changed";
+                break;
+            case 1:
+                for (int k = 0; k < span; ++k)
+                    new_lines.insert(new_lines.begin() + static_cast<long>(at), "  " + words(rng, 3) + " added");
+                break;
+            default:
+                new_lines.erase(new_lines.begin() + static_cast<long>(at),
+                                new_lines.begin() + static_cast<long>(std::min(new_lines.size(), at + span)));
+                break;
+        }
+    }
+}
+
+PacmanConfig write_alpm_fixture(const std::string& root, int local_count,
+                                const std::vector<std::string>& repos, int sync_count,
+                                std::vector<std::string>* sync_names) {
+    fs::remove_all(root);
+    fs::create_directories(root + "/root");
+    fs::create_directories(root + "/db/local");
+    fs::create_directories(root + "/db/sync");
+    std::ofstream(root + "/db/local/ALPM_DB_VERSION") << "9\n";
+
+    PacmanConfig config;
+    config.root_dir = root + "/root/";
+    config.db_path = root + "/db/";
+    config.log_file = root + "/pacman.log";
+    config.gpg_dir = root + "/gnupg/";
+    config.architecture = "x86_64";
+    config.siglevel = 0;
+
+    struct Pkg {
+        std::string name;
+        std::string version;
+        std::string description;
+    };
+    std::vector<Pkg> all;
+
+    Rng rng(7);
+    for (const auto& repo : repos) {
+        std::string tar;
+        for (int i = 0; i < sync_count; ++i) {
+            Pkg pkg{"lib" + std::to_string(all.size()) + "-" + WORDS[rng.below(26)],
+                    version(rng), words(rng, 8)};
+            std::string desc;
+            desc_field(desc, "FILENAME", pkg.name + "-" + pkg.version + "-x86_64.pkg.tar.zst");
+            desc_field(desc, "NAME", pkg.name);
+            desc_field(desc, "BASE", pkg.name);
+            desc_field(desc, "VERSION", pkg.version);
+            desc_field(desc, "DESC", pkg.description);
+            desc_field(desc, "CSIZE", std::to_string(rng.below(50000000)));
+            desc_field(desc, "ISIZE", std::to_string(rng.below(150000000)));
+            desc_field(desc, "URL", "https://example.org/" + pkg.name);
+            desc_field(desc, "LICENSE", "MIT");
+            desc_field(desc, "ARCH", "x86_64");
+            desc_field(desc, "BUILDDATE", std::to_string(1600000000 + rng.below(100000000)));
+            desc_field(desc, "PACKAGER", "Bench <bench@example.org>");
+            tar_entry(tar, pkg.name + "-" + pkg.version + "/", "", true);
+            tar_entry(tar, pkg.name + "-" + pkg.version + "/desc", desc, false);
+            if (sync_names) sync_names->push_back(pkg.name);
+            all.push_back(std::move(pkg));
+        }
+        tar.append(1024, '\0');
+        std::ofstream(root + "/db/sync/" + repo + ".db", std::ios::binary) << tar;
+        config.repos.push_back({repo, {"file://" + root + "/mirror/$repo"}, 0});
+    }
+
+    /* installed packages are mostly taken from the sync set, some a release behind,
+       and the rest are foreign */
+    for (int i = 0; i < local_count; ++i) {
+        Pkg pkg;
+        if (i < static_cast<int>(all.size()) && rng.below(10) != 0) {
+            pkg = all[static_cast<size_t>(i)];
+            if (rng.below(8) == 0) pkg.version = "0." + pkg.version;
+        } else {
+            pkg = {"foreign" + std::to_string(i) + "-" + WORDS[rng.below(26)], version(rng), words(rng, 8)};
+        }
+        std::string desc;
+        desc_field(desc, "NAME", pkg.name);
+        desc_field(desc, "VERSION", pkg.version);
+        desc_field(desc, "BASE", pkg.name);
+        desc_field(desc, "DESC", pkg.description);
+        desc_field(desc, "URL", "https://example.org/" + pkg.name);
+        desc_field(desc, "ARCH", "x86_64");
+        desc_field(desc, "BUILDDATE", std::to_string(1600000000 + rng.below(100000000)));
+        desc_field(desc, "INSTALLDATE", std::to_string(1700000000 + rng.below(1000000)));
+        desc_field(desc, "PACKAGER", "Bench <bench@example.org>");
+        desc_field(desc, "SIZE", std::to_string(rng.below(100000000)));
+        desc_field(desc, "REASON", std::to_string(rng.below(2)));
+        desc_field(desc, "LICENSE", "MIT");
+        std::string dir = root + "/db/local/" + pkg.name + "-" + pkg.version;
+        fs::create_directories(dir);
+        std::ofstream(dir + "/desc") << desc;
+        std::ofstream(dir + "/files") << "%FILES%\nusr/\n\n";
+    }
+    return config;
+}
+
+void write_aur_cache_fixture(const std::string& home, int packages, int fanout,
+                             const std::vector<std::string>& repo_libs) {
+    std::string dir = home + "/.cache/pmt/aur";
+    fs::create_directories(dir);
+    fs::remove(dir + "/.rpc_cache");
+
+    Rng rng(11);
+    AurCache cache(dir + "/.rpc_cache");
+    for (int i = 0; i < packages; ++i) {
+        PackageInfo p;
+        p.name = i == 0 ? "bench-root" : "bench-aur-" + std::to_string(i);
+        p.pkgbase = p.name;
+        p.version = version(rng);
+        p.description = words(rng, 6);
+        p.source = PackageSource::AUR;
+        p.repo = "aur";
+        p.aur_last_modified = 1700000000;
+        /* children of node i are fanout*i+1 .. fanout*i+fanout, so the graph is a tree */
+        for (int c = fanout * i + 1; c <= fanout * i + fanout && c < packages; ++c)
+            p.depends.push_back("bench-aur-" + std::to_string(c));
+        if (!repo_libs.empty()) {
+            for (int d = rng.below(3); d > 0; --d)
+                p.depends.push_back(repo_libs[static_cast<size_t>(rng.below(static_cast<int>(repo_libs.size())))]);
+        }
+        cache.put_info(p);
+    }
+    cache.save();
+}
+
+}
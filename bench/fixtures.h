@@ -0,0 +1,47 @@
+#pragma once
+#include "package.h"
+#include "pacman_conf.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pmt::bench {
+
+/* deterministic generator so fixtures are identical across runs and machines */
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state_(seed ? seed : 1) {}
+    uint64_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+    int below(int n) { return static_cast<int>(next() % static_cast<uint64_t>(n)); }
+
+private:
+    uint64_t state_;
+};
+
+/* an /rpc/v5 reply with count results shaped like the live AUR; info replies carry
+   the dependency arrays that search replies omit */
+std::string aur_response(int count, bool info, uint64_t seed = 1);
+
+std::vector<PackageInfo> synthetic_packages(int count, uint64_t seed = 1);
+
+/* a PKGBUILD-like file of lines lines and a revision with edits scattered hunks */
+void pkgbuild_pair(int lines, int edits, std::vector<std::string>& old_lines,
+                   std::vector<std::string>& new_lines, uint64_t seed = 1);
+
+/* writes sync DBs with sync_count packages each and a local DB of local_count packages
+   under root; returns the config that points libalpm at it */
+PacmanConfig write_alpm_fixture(const std::string& root, int local_count,
+                                const std::vector<std::string>& repos, int sync_count,
+                                std::vector<std::string>* sync_names = nullptr);
+
+/* seeds an AUR metadata cache under home with a dependency tree of AUR packages
+   rooted at "bench-root", so the resolver runs without the network */
+void write_aur_cache_fixture(const std::string& home, int packages, int fanout,
+                             const std::vector<std::string>& repo_libs);
+
+}
@@ -0,0 +1,274 @@
+#include "bench.h"
+#include "fixtures.h"
+#include "alpm_wrapper.h"
+#include "aur.h"
+#include "dep_resolver.h"
+#include "diff.h"
+#include "json.h"
+#include "package_list.h"
+#include "terminal.h"
+#include "ui.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+namespace pmt {
+
+/* reaches the private reply parser so it can be timed without a connection */
+struct AurBenchAccess {
+    static std::vector<PackageInfo> parse_results(AurClient& aur, const std::string& body) {
+        return aur.parse_results(body);
+    }
+};
+
+}
+
+using namespace pmt;
+using namespace pmt::bench;
+
+namespace {
+
+struct Options {
+    std::string filter;
+    double min_ms = 200;
+    std::string fixture_dir = "/tmp/pmt-bench";
+};
+
+/* stdout is swapped for a pty slave of a fixed size so Terminal sees a real screen;
+   everything written is drained and counted on the master side */
+class PtyCapture {
+public:
+    bool open(int rows, int cols) {
+        master_ = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master_ < 0 || grantpt(master_) != 0 || unlockpt(master_) != 0) return false;
+        int slave = ::open(ptsname(master_), O_RDWR | O_NOCTTY);
+        if (slave < 0) return false;
+
+        struct termios t{};
+        tcgetattr(slave, &t);
+        cfmakeraw(&t);
+        tcsetattr(slave, TCSANOW, &t);
+        struct winsize ws{};
+        ws.ws_row = static_cast<unsigned short>(rows);
+        ws.ws_col = static_cast<unsigned short>(cols);
+        ioctl(slave, TIOCSWINSZ, &ws);
+
+        saved_stdout_ = dup(STDOUT_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        ::close(slave);
+
+        drain_ = std::thread([this]() {
+            char buf[65536];
+            for (;;) {
+                ssize_t n = read(master_, buf, sizeof(buf));
+                if (n <= 0) break;
+                bytes_ += static_cast<uint64_t>(n);
+            }
+        });
+        return true;
+    }
+
+    /* waits until the drain thread has caught up with everything written so far */
+    uint64_t settled_bytes() {
+        uint64_t last = bytes_.load();
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            uint64_t now = bytes_.load();
+            if (now == last) return now;
+            last = now;
+        }
+    }
+
+    void close() {
+        if (saved_stdout_ >= 0) {
+            dup2(saved_stdout_, STDOUT_FILENO);
+            ::close(saved_stdout_);
+            saved_stdout_ = -1;
+        }
+        if (drain_.joinable()) drain_.join();
+        if (master_ >= 0) ::close(master_);
+        master_ = -1;
+    }
+
+    ~PtyCapture() { close(); }
+
+private:
+    int master_ = -1;
+    int saved_stdout_ = -1;
+    std::thread drain_;
+    std::atomic<uint64_t> bytes_{0};
+};
+
+void bench_json(Runner& r, AurClient& aur) {
+    struct Case { const char* name; int count; bool info; };
+    for (const Case& c : {Case{"search_10", 10, false}, Case{"search_500", 500, false},
+                          Case{"search_5000", 5000, false}, Case{"info_200", 200, true}}) {
+        std::string body = aur_response(c.count, c.info);
+        double bytes = static_cast<double>(body.size());
+        std::string suffix = std::string("/") + c.name;
+
+        r.run("json/parse" + suffix, [&]() {
+            JsonParser parser;
+            const JsonValue* root = parser.parse(body);
+            return root ? (*root)["results"]->size() : 0;
+        }, {{"bytes", bytes}});
+
+        r.run("json/stream" + suffix, [&]() {
+            JsonHandler handler;
+            JsonStreamParser parser(handler);
+            for (size_t off = 0; off < body.size(); off += 16384)
+                parser.feed(body.data() + off, std::min<size_t>(16384, body.size() - off));
+            return parser.finish() ? 1 : 0;
+        }, {{"bytes", bytes}});
+
+        r.run("aur/parse_results" + suffix, [&]() {
+            return AurBenchAccess::parse_results(aur, body).size();
+        }, {{"bytes", bytes}, {"results", static_cast<double>(c.count)}});
+    }
+}
+
+void bench_diff(Runner& r) {
+    struct Case { int lines; int edits; };
+    for (const Case& c : {Case{200, 5}, Case{2000, 40}, Case{20000, 200}, Case{3000, 3000}}) {
+        std::vector<std::string> old_lines, new_lines;
+        pkgbuild_pair(c.lines, c.edits, old_lines, new_lines);
+        r.run("diff/compute_diff/" + std::to_string(c.lines) + "x" + std::to_string(c.edits), [&]() {
+            return compute_diff(old_lines, new_lines).size();
+        }, {{"old_lines", static_cast<double>(old_lines.size())},
+            {"new_lines", static_cast<double>(new_lines.size())}});
+    }
+}
+
+void bench_alpm(Runner& r, AlpmWrapper& alpm, const PacmanConfig& config) {
+    r.run("alpm/load_local", [&]() {
+        alpm.init(config);
+        return alpm.list_installed().size();
+    });
+    r.run("alpm/list_installed", [&]() { return alpm.list_installed().size(); });
+    alpm.warm_sync_index();
+    r.run("alpm/search/lib1", [&]() { return alpm.search("lib1").size(); });
+    r.run("alpm/search/regex", [&]() { return alpm.search("^lib[0-9]+-git$").size(); });
+    r.run("alpm/list_updates", [&]() { return alpm.list_updates().size(); });
+}
+
+void bench_resolve(Runner& r, AurClient& aur, AlpmWrapper& alpm) {
+    DepResolution probe = DepResolver(aur, alpm).resolve("bench-root");
+    if (!probe.ok) {
+        r.note("resolve/tree", probe.error);
+        return;
+    }
+    r.run("resolve/tree", [&]() {
+        return DepResolver(aur, alpm).resolve("bench-root").aur_build_order.size();
+    }, {{"aur_packages", static_cast<double>(probe.aur_build_order.size())},
+        {"repo_deps", static_cast<double>(probe.repo_deps.size())}});
+}
+
+void bench_ui(Runner& r) {
+    if (!r.enabled("ui/")) return;
+    PtyCapture pty;
+    if (!pty.open(50, 200)) {
+        r.note("ui/draw", "no pty available");
+        return;
+    }
+
+    {
+        auto infos = synthetic_packages(3000);
+        std::vector<PackageRow> rows;
+        rows.reserve(infos.size());
+        for (const auto& info : infos) rows.push_back(make_row(info));
+        PackageList list(std::move(rows));
+        PackageInfo detail = infos[0];
+
+        Terminal term;
+        term.enter_alt_screen();
+        pmt::UI ui(term);
+        ui.detail_loader = [&](const PackageRow&) { return detail; };
+        int n = static_cast<int>(list.size());
+
+        struct Case {
+            const char* name;
+            std::function<void()> step;
+        };
+        std::vector<Case> cases = {
+            {"ui/draw/full", [&]() { term.invalidate(); }},
+            {"ui/draw/scroll", [&]() { ui.selected = (ui.selected + 1) % n; ui.ensure_visible(); }},
+            {"ui/draw/idle", []() {}},
+        };
+        for (auto& c : cases) {
+            if (!r.enabled(c.name)) continue;
+            ui.draw(list);
+            constexpr int FRAMES = 200;
+            uint64_t before = pty.settled_bytes();
+            for (int i = 0; i < FRAMES; ++i) {
+                c.step();
+                ui.draw(list);
+            }
+            double bytes = static_cast<double>(pty.settled_bytes() - before) / FRAMES;
+
+            uint64_t iters = 0;
+            double ns = r.measure([&]() {
+                c.step();
+                ui.draw(list);
+                return ui.selected;
+            }, iters);
+            pty.settled_bytes();
+            r.report(c.name, {{"iters", static_cast<double>(iters)}, {"ns_per_op", ns},
+                              {"bytes_per_frame", bytes}, {"rows", 50}, {"cols", 200}});
+        }
+    }
+    pty.close();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            opts.filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+            opts.min_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--fixtures") == 0 && i + 1 < argc) {
+            opts.fixture_dir = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: pmt-bench [--filter SUBSTR] [--min-ms MS] [--fixtures DIR]\n");
+            return 1;
+        }
+    }
+
+    FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out) return 1;
+    Runner r(out, opts.filter, opts.min_ms);
+
+    /* the AUR client reads its metadata cache from $HOME, which holds the resolver fixture */
+    std::string home = opts.fixture_dir + "/home";
+    std::vector<std::string> sync_names;
+    PacmanConfig config = write_alpm_fixture(opts.fixture_dir + "/alpm", 1500,
+                                             {"bench-core", "bench-extra"}, 6000, &sync_names);
+    write_aur_cache_fixture(home, 120, 3, sync_names);
+    setenv("HOME", home.c_str(), 1);
+    unsetenv("SUDO_USER");
+
+    AurClient aur;
+    AlpmWrapper alpm;
+    bool alpm_ok = alpm.init(config);
+
+    bench_json(r, aur);
+    bench_diff(r);
+    if (alpm_ok) {
+        bench_alpm(r, alpm, config);
+        if (r.enabled("resolve/")) bench_resolve(r, aur, alpm);
+    } else {
+        r.note("alpm", alpm.last_error());
+    }
+    bench_ui(r);
+
+    fclose(out);
+    return 0;
+}
@@ -1,7 +1,7 @@
 #include "alpm_wrapper.h"
+#include "perf.h"
 #include <unistd.h>
 #include <cstring>
-#include <dirent.h>
 #include <algorithm>
 
 namespace pmt {
@@ -19,12 +19,14 @@ AlpmWrapper::~AlpmWrapper() {
 
 /* initializes libalpm handle with pacman.conf settings */
 bool AlpmWrapper::init(const PacmanConfig& config) {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (handle_) {
         alpm_release(handle_);
         handle_ = nullptr;
     }
 
     saved_config_ = config;
+    invalidate_caches();
 
     alpm_errno_t err;
     handle_ = alpm_initialize(config.root_dir.c_str(), config.db_path.c_str(), &err);
@@ -35,6 +37,7 @@ bool AlpmWrapper::init(const PacmanConfig& config) {
 
     alpm_option_set_logfile(handle_, config.log_file.c_str());
     alpm_option_set_gpgdir(handle_, config.gpg_dir.c_str());
+    alpm_option_set_parallel_downloads(handle_, static_cast<unsigned int>(config.parallel_downloads));
 
     alpm_option_set_progresscb(handle_, progress_callback, this);
     alpm_option_set_dlcb(handle_, download_callback, this);
@@ -64,11 +67,68 @@ bool AlpmWrapper::init(const PacmanConfig& config) {
 }
 
 bool AlpmWrapper::reload() {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     return init(saved_config_);
 }
 
-std::vector<PackageInfo> AlpmWrapper::search(const std::string& query) {
-    std::vector<PackageInfo> results;
+/* stales everything holding alpm_pkg_t pointers; libalpm may have reloaded a package cache.
+   Caller holds handle_mutex_, so the indexes notice the new generation and rebuild on next use */
+void AlpmWrapper::invalidate_caches() {
+    generation_++;
+}
+
+/* reorders each sync db's servers fastest first; mirrors are probed once per process */
+void AlpmWrapper::rank_mirrors() {
+    alpm_list_t* syncdbs = alpm_get_syncdbs(handle_);
+    std::vector<std::vector<std::string>> servers;
+    std::vector<std::string> all;
+    for (alpm_list_t* i = syncdbs; i; i = alpm_list_next(i)) {
+        servers.emplace_back();
+        for (alpm_list_t* s = alpm_db_get_servers(static_cast<alpm_db_t*>(i->data)); s;
+             s = alpm_list_next(s)) {
+            servers.back().push_back(static_cast<const char*>(s->data));
+            all.push_back(servers.back().back());
+        }
+    }
+    if (all.size() < 2) return;
+
+    if (mirrors_.needs_probe(all) && event_cb_) event_cb_("Ranking mirrors...");
+    mirrors_.rank(all);
+
+    size_t n = 0;
+    for (alpm_list_t* i = syncdbs; i; i = alpm_list_next(i), ++n) {
+        if (servers[n].size() < 2) continue;
+        mirrors_.rank(servers[n]);
+        alpm_list_t* list = nullptr;
+        for (const auto& url : servers[n]) list = alpm_list_add(list, strdup(url.c_str()));
+        alpm_db_set_servers(static_cast<alpm_db_t*>(i->data), list);
+    }
+}
+
+/* searches the sync index, built lazily on the first query after init/reload */
+std::vector<PackageRow> AlpmWrapper::search(const std::string& query) {
+    std::vector<PackageRow> results;
+    if (!handle_ || query.empty()) return results;
+    perf::Scope timer(perf::AlpmSearch);
+    if (PackageIndex::needs_regex(query)) return search_regex(query);
+
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto hits = sync_index().search(query);
+    std::lock_guard<std::recursive_mutex> alpm(handle_mutex_);
+    /* a transaction reloaded the caches after the index was built; its pointers are gone */
+    if (index_gen_ != generation_) return results;
+    results.reserve(hits.size());
+    for (uint32_t id : hits) {
+        auto row = pkg_to_row(sync_index_.pkg(id), sync_index_.repo(id));
+        mark_installed(row);
+        results.push_back(std::move(row));
+    }
+    return results;
+}
+
+std::vector<PackageRow> AlpmWrapper::search_regex(const std::string& query) {
+    std::vector<PackageRow> results;
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_ || query.empty()) return results;
 
     alpm_list_t* needles = nullptr;
@@ -81,9 +141,9 @@ std::vector<PackageInfo> AlpmWrapper::search(const std::string& query) {
         if (alpm_db_search(db, needles, &ret) == 0) {
             for (alpm_list_t* j = ret; j; j = alpm_list_next(j)) {
                 alpm_pkg_t* pkg = static_cast<alpm_pkg_t*>(j->data);
-                auto info = pkg_to_info(pkg, alpm_db_get_name(db));
-                mark_installed(info);
-                results.push_back(std::move(info));
+                auto row = pkg_to_row(pkg, alpm_db_get_name(db));
+                mark_installed(row);
+                results.push_back(std::move(row));
             }
             alpm_list_free(ret);
         }
@@ -93,8 +153,9 @@ std::vector<PackageInfo> AlpmWrapper::search(const std::string& query) {
     return results;
 }
 
-std::vector<PackageInfo> AlpmWrapper::list_installed() {
-    std::vector<PackageInfo> results;
+std::vector<PackageRow> AlpmWrapper::list_installed() {
+    std::vector<PackageRow> results;
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) return results;
 
     alpm_db_t* localdb = alpm_get_localdb(handle_);
@@ -102,42 +163,83 @@ std::vector<PackageInfo> AlpmWrapper::list_installed() {
 
     for (alpm_list_t* i = pkgs; i; i = alpm_list_next(i)) {
         alpm_pkg_t* pkg = static_cast<alpm_pkg_t*>(i->data);
-        auto info = pkg_to_info(pkg, "local");
-        info.installed = true;
-        info.installed_version = info.version;
-        info.source = PackageSource::Local;
-        results.push_back(std::move(info));
+        auto row = pkg_to_row(pkg, "local");
+        row.installed = true;
+        row.installed_version = row.version;
+        row.source = PackageSource::Local;
+        results.push_back(std::move(row));
     }
 
     return results;
 }
 
-std::vector<PackageInfo> AlpmWrapper::list_updates() {
-    std::vector<PackageInfo> results;
-    if (!handle_) return results;
+std::vector<PackageRow> AlpmWrapper::list_updates() {
+    std::vector<PackageRow> results;
+    scan_local(nullptr, &results);
+    return results;
+}
 
-    alpm_db_t* localdb = alpm_get_localdb(handle_);
-    alpm_list_t* syncdbs = alpm_get_syncdbs(handle_);
-    alpm_list_t* pkgs = alpm_db_get_pkgcache(localdb);
+/* builds the shared sync index on first use and after a cache reload; caller holds
+   index_mutex_ but not handle_mutex_. The handle is only held while the sync DBs are
+   read, so detail lookups on the UI thread aren't stuck behind the trigram build */
+PackageIndex& AlpmWrapper::sync_index() {
+    uint64_t gen;
+    {
+        std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
+        gen = generation_;
+        if (sync_index_.built() && index_gen_ == gen) return sync_index_;
+        sync_index_.load(handle_);
+    }
+    sync_index_.finish();
+    index_gen_ = gen;
+    return sync_index_;
+}
 
-    for (alpm_list_t* i = pkgs; i; i = alpm_list_next(i)) {
+/* loads the sync DB caches and their name index before the first search or scan needs them */
+void AlpmWrapper::warm_sync_index() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    sync_index();
+}
+
+/* one pass over the local DB against the sync name index: a local package missing
+   from every sync DB is foreign, one with a newer sync version has an update */
+void AlpmWrapper::scan_local(std::vector<PackageRow>* foreign, std::vector<PackageRow>* updates) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    PackageIndex& index = sync_index();
+    std::lock_guard<std::recursive_mutex> alpm(handle_mutex_);
+    if (!handle_ || index_gen_ != generation_) return;
+
+    alpm_db_t* localdb = alpm_get_localdb(handle_);
+    for (alpm_list_t* i = alpm_db_get_pkgcache(localdb); i; i = alpm_list_next(i)) {
         alpm_pkg_t* local_pkg = static_cast<alpm_pkg_t*>(i->data);
-        alpm_pkg_t* new_pkg = alpm_sync_get_new_version(local_pkg, syncdbs);
-        if (new_pkg) {
-            alpm_db_t* db = alpm_pkg_get_db(new_pkg);
-            auto info = pkg_to_info(new_pkg, db ? alpm_db_get_name(db) : "unknown");
-            info.installed = true;
-            info.installed_version = alpm_pkg_get_version(local_pkg);
-            info.has_update = true;
-            results.push_back(std::move(info));
+        uint32_t id = index.find(alpm_pkg_get_name(local_pkg));
+
+        if (id == PackageIndex::npos) {
+            if (!foreign) continue;
+            auto row = pkg_to_row(local_pkg, "local");
+            row.installed = true;
+            row.installed_version = row.version;
+            row.source = PackageSource::Local;
+            foreign->push_back(std::move(row));
+            continue;
         }
-    }
 
-    return results;
+        if (!updates) continue;
+        alpm_pkg_t* new_pkg = index.pkg(id);
+        const char* local_version = alpm_pkg_get_version(local_pkg);
+        if (alpm_pkg_vercmp(alpm_pkg_get_version(new_pkg), local_version) > 0) {
+            auto row = pkg_to_row(new_pkg, index.repo(id));
+            row.installed = true;
+            row.installed_version = local_version;
+            row.has_update = true;
+            updates->push_back(std::move(row));
+        }
+    }
 }
 
 /* installs a sync repo package via alpm transaction */
 bool AlpmWrapper::install_package(const std::string& name) {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) { last_error_ = "Not initialized"; return false; }
     if (!is_root_) { last_error_ = "Root privileges required"; return false; }
 
@@ -176,7 +278,9 @@ bool AlpmWrapper::install_package(const std::string& name) {
         return false;
     }
 
+    rank_mirrors();
     ret = alpm_trans_commit(handle_, &data);
+    invalidate_caches();
     if (ret != 0) {
         last_error_ = "Failed to commit transaction: " + std::string(alpm_strerror(alpm_errno(handle_)));
         FREELIST(data);
@@ -191,6 +295,7 @@ bool AlpmWrapper::install_package(const std::string& name) {
 
 /* removes an installed package via alpm transaction */
 bool AlpmWrapper::remove_package(const std::string& name) {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) { last_error_ = "Not initialized"; return false; }
     if (!is_root_) { last_error_ = "Root privileges required"; return false; }
 
@@ -224,6 +329,7 @@ bool AlpmWrapper::remove_package(const std::string& name) {
     }
 
     ret = alpm_trans_commit(handle_, &data);
+    invalidate_caches();
     if (ret != 0) {
         last_error_ = "Failed to commit transaction: " + std::string(alpm_strerror(alpm_errno(handle_)));
         FREELIST(data);
@@ -238,6 +344,7 @@ bool AlpmWrapper::remove_package(const std::string& name) {
 
 /* performs full system upgrade via alpm */
 bool AlpmWrapper::system_upgrade() {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) { last_error_ = "Not initialized"; return false; }
     if (!is_root_) { last_error_ = "Root privileges required"; return false; }
 
@@ -270,7 +377,9 @@ bool AlpmWrapper::system_upgrade() {
         return true;
     }
 
+    rank_mirrors();
     ret = alpm_trans_commit(handle_, &data);
+    invalidate_caches();
     if (ret != 0) {
         last_error_ = "Failed to commit transaction: " + std::string(alpm_strerror(alpm_errno(handle_)));
         FREELIST(data);
@@ -284,11 +393,15 @@ bool AlpmWrapper::system_upgrade() {
 }
 
 bool AlpmWrapper::sync_databases(bool force) {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) { last_error_ = "Not initialized"; return false; }
     if (!is_root_) { last_error_ = "Root privileges required"; return false; }
 
+    rank_mirrors();
+    downloads_.begin(0, 0);
     alpm_list_t* syncdbs = alpm_get_syncdbs(handle_);
     int ret = alpm_db_update(handle_, syncdbs, force ? 1 : 0);
+    invalidate_caches();
     if (ret < 0) {
         last_error_ = "Failed to sync databases: " + std::string(alpm_strerror(alpm_errno(handle_)));
         return false;
@@ -299,37 +412,18 @@ bool AlpmWrapper::sync_databases(bool force) {
 /* scans pacman cache dirs for available package versions */
 std::vector<std::pair<std::string, std::string>> AlpmWrapper::list_cached_versions(const std::string& name) {
     std::vector<std::pair<std::string, std::string>> results;
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) return results;
 
-    alpm_list_t* cachedirs = alpm_option_get_cachedirs(handle_);
-    std::string prefix = name + "-";
-
-    for (alpm_list_t* i = cachedirs; i; i = alpm_list_next(i)) {
-        const char* dir = static_cast<const char*>(i->data);
-        DIR* d = opendir(dir);
-        if (!d) continue;
-
-        struct dirent* entry;
-        while ((entry = readdir(d)) != nullptr) {
-            std::string fname = entry->d_name;
-            if (fname.find(prefix) != 0) continue;
-
-            size_t pkg_pos = fname.find(".pkg.tar.");
-            if (pkg_pos == std::string::npos) continue;
-
-            std::string after_name = fname.substr(prefix.size(), pkg_pos - prefix.size());
-            size_t last_dash = after_name.rfind('-');
-            if (last_dash == std::string::npos) continue;
-            std::string arch = after_name.substr(last_dash + 1);
-            if (arch != "any" && arch != "x86_64") continue;
+    std::vector<std::string> dirs;
+    for (alpm_list_t* i = alpm_option_get_cachedirs(handle_); i; i = alpm_list_next(i))
+        dirs.push_back(static_cast<const char*>(i->data));
+    pkg_cache_.set_dirs(dirs);
+    pkg_cache_.refresh();
 
-            std::string version = after_name.substr(0, last_dash);
-            if (version.empty()) continue;
-
-            std::string filepath = std::string(dir) + fname;
-            results.emplace_back(version, filepath);
-        }
-        closedir(d);
+    for (const auto& pkg : pkg_cache_.find(name)) {
+        if (pkg.arch != "any" && pkg.arch != saved_config_.architecture) continue;
+        results.emplace_back(pkg.version, pkg.path);
     }
 
     std::sort(results.begin(), results.end(),
@@ -346,6 +440,7 @@ std::vector<std::pair<std::string, std::string>> AlpmWrapper::list_cached_versio
 
 /* installs an older cached package with NODEPS flag */
 bool AlpmWrapper::downgrade_package(const std::string& filepath) {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) { last_error_ = "Not initialized"; return false; }
     if (!is_root_) { last_error_ = "Root privileges required"; return false; }
 
@@ -380,6 +475,7 @@ bool AlpmWrapper::downgrade_package(const std::string& filepath) {
     }
 
     ret = alpm_trans_commit(handle_, &data);
+    invalidate_caches();
     if (ret != 0) {
         last_error_ = "Failed to commit transaction: " + std::string(alpm_strerror(alpm_errno(handle_)));
         FREELIST(data);
@@ -392,6 +488,59 @@ bool AlpmWrapper::downgrade_package(const std::string& filepath) {
     return true;
 }
 
+PackageRow AlpmWrapper::pkg_to_row(alpm_pkg_t* pkg, const std::string& repo) {
+    PackageRow row;
+    const char* s;
+
+    s = alpm_pkg_get_name(pkg);
+    if (s) row.name = s;
+    s = alpm_pkg_get_version(pkg);
+    if (s) row.version = s;
+
+    row.repo = repo;
+    row.download_size = alpm_pkg_get_size(pkg);
+    row.install_size = alpm_pkg_get_isize(pkg);
+    row.build_date = alpm_pkg_get_builddate(pkg);
+    row.install_date = alpm_pkg_get_installdate(pkg);
+    row.source = PackageSource::Sync;
+    row.handle = pkg;
+    row.handle_gen = generation_;
+    return row;
+}
+
+/* fills the full detail fields for a row, re-resolving its package after a reload */
+PackageInfo AlpmWrapper::package_details(const PackageRow& row) {
+    if (row.details) return *row.details;
+
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
+    PackageInfo info;
+    alpm_pkg_t* pkg = nullptr;
+    if (handle_ && row.handle && row.handle_gen == generation_) {
+        pkg = static_cast<alpm_pkg_t*>(row.handle);
+    } else if (handle_ && row.source == PackageSource::Local) {
+        pkg = alpm_db_get_pkg(alpm_get_localdb(handle_), row.name.c_str());
+    } else if (handle_) {
+        for (alpm_list_t* i = alpm_get_syncdbs(handle_); i && !pkg; i = alpm_list_next(i)) {
+            alpm_db_t* db = static_cast<alpm_db_t*>(i->data);
+            if (row.repo == alpm_db_get_name(db))
+                pkg = alpm_db_get_pkg(db, row.name.c_str());
+        }
+    }
+
+    if (pkg) {
+        info = pkg_to_info(pkg, row.repo);
+    } else {
+        info.name = row.name;
+        info.version = row.version;
+        info.repo = row.repo;
+    }
+    info.source = row.source;
+    info.installed = row.installed;
+    info.installed_version = row.installed_version;
+    info.has_update = row.has_update;
+    return info;
+}
+
 PackageInfo AlpmWrapper::pkg_to_info(alpm_pkg_t* pkg, const std::string& repo) {
     PackageInfo info;
     const char* s;
@@ -425,69 +574,54 @@ PackageInfo AlpmWrapper::pkg_to_info(alpm_pkg_t* pkg, const std::string& repo) {
     return info;
 }
 
-std::vector<PackageInfo> AlpmWrapper::list_foreign() {
-    std::vector<PackageInfo> results;
-    if (!handle_) return results;
-
-    alpm_db_t* localdb = alpm_get_localdb(handle_);
-    alpm_list_t* pkgs = alpm_db_get_pkgcache(localdb);
-    alpm_list_t* syncdbs = alpm_get_syncdbs(handle_);
-
-    for (alpm_list_t* i = pkgs; i; i = alpm_list_next(i)) {
-        alpm_pkg_t* pkg = static_cast<alpm_pkg_t*>(i->data);
-        const char* name = alpm_pkg_get_name(pkg);
-
-        bool in_sync = false;
-        for (alpm_list_t* j = syncdbs; j; j = alpm_list_next(j)) {
-            alpm_db_t* db = static_cast<alpm_db_t*>(j->data);
-            if (alpm_db_get_pkg(db, name)) {
-                in_sync = true;
-                break;
-            }
-        }
-
-        if (!in_sync) {
-            auto info = pkg_to_info(pkg, "local");
-            info.installed = true;
-            info.installed_version = info.version;
-            info.source = PackageSource::Local;
-            results.push_back(std::move(info));
-        }
-    }
-
+std::vector<PackageRow> AlpmWrapper::list_foreign() {
+    std::vector<PackageRow> results;
+    scan_local(&results, nullptr);
     return results;
 }
 
+/* caller holds satisfier_mutex_ and handle_mutex_ */
+void AlpmWrapper::refresh_satisfiers() {
+    if (satisfier_gen_ == generation_) return;
+    local_satisfiers_.clear();
+    sync_satisfiers_.clear();
+    satisfier_gen_ = generation_;
+}
+
 bool AlpmWrapper::is_dep_satisfied(const std::string& depstring) {
+    std::lock_guard<std::mutex> lock(satisfier_mutex_);
+    std::lock_guard<std::recursive_mutex> alpm(handle_mutex_);
     if (!handle_) return false;
-    alpm_depend_t* dep = alpm_dep_from_string(depstring.c_str());
-    if (!dep) return false;
-    alpm_db_t* localdb = alpm_get_localdb(handle_);
-    alpm_list_t* pkgs = alpm_db_get_pkgcache(localdb);
-    alpm_pkg_t* found = alpm_find_satisfier(pkgs, depstring.c_str());
-    alpm_dep_free(dep);
-    return found != nullptr;
+    refresh_satisfiers();
+    if (!local_satisfiers_.built())
+        local_satisfiers_.build({alpm_get_localdb(handle_)});
+    return local_satisfiers_.find(depstring) != nullptr;
 }
 
 bool AlpmWrapper::is_dep_in_repos(const std::string& depstring) {
+    std::lock_guard<std::mutex> lock(satisfier_mutex_);
+    std::lock_guard<std::recursive_mutex> alpm(handle_mutex_);
     if (!handle_) return false;
-    alpm_depend_t* dep = alpm_dep_from_string(depstring.c_str());
-    if (!dep) return false;
-    alpm_list_t* syncdbs = alpm_get_syncdbs(handle_);
-    alpm_pkg_t* found = alpm_find_dbs_satisfier(handle_, syncdbs, depstring.c_str());
-    alpm_dep_free(dep);
-    return found != nullptr;
+    refresh_satisfiers();
+    if (!sync_satisfiers_.built()) {
+        std::vector<alpm_db_t*> dbs;
+        for (alpm_list_t* i = alpm_get_syncdbs(handle_); i; i = alpm_list_next(i))
+            dbs.push_back(static_cast<alpm_db_t*>(i->data));
+        sync_satisfiers_.build(dbs);
+    }
+    return sync_satisfiers_.find(depstring) != nullptr;
 }
 
-void AlpmWrapper::mark_installed(PackageInfo& info) {
+void AlpmWrapper::mark_installed(PackageRow& row) {
+    std::lock_guard<std::recursive_mutex> lock(handle_mutex_);
     if (!handle_) return;
     alpm_db_t* localdb = alpm_get_localdb(handle_);
-    alpm_pkg_t* local_pkg = alpm_db_get_pkg(localdb, info.name.c_str());
+    alpm_pkg_t* local_pkg = alpm_db_get_pkg(localdb, row.name.c_str());
     if (local_pkg) {
-        info.installed = true;
-        info.installed_version = alpm_pkg_get_version(local_pkg);
-        if (info.version != info.installed_version) {
-            info.has_update = true;
+        row.installed = true;
+        row.installed_version = alpm_pkg_get_version(local_pkg);
+        if (row.version != row.installed_version) {
+            row.has_update = true;
         }
     }
 }
@@ -530,20 +664,42 @@ void AlpmWrapper::download_callback(void* ctx, const char* filename,
     auto* self = static_cast<AlpmWrapper*>(ctx);
     if (!self->progress_cb_) return;
 
-    std::string label = filename ? filename : "Downloading";
+    std::string file = filename ? filename : "";
+    DownloadProgress& dl = self->downloads_;
 
-    if (event == ALPM_DOWNLOAD_PROGRESS) {
-        auto* progress = static_cast<alpm_download_event_progress_t*>(data);
-        if (progress && progress->total > 0) {
-            self->progress_cb_("Downloading " + label,
-                             static_cast<double>(progress->downloaded) / progress->total);
+    switch (event) {
+        case ALPM_DOWNLOAD_INIT:
+            dl.init(file);
+            break;
+        case ALPM_DOWNLOAD_PROGRESS: {
+            auto* progress = static_cast<alpm_download_event_progress_t*>(data);
+            if (progress) dl.update(file, progress->downloaded, progress->total);
+            break;
+        }
+        case ALPM_DOWNLOAD_RETRY:
+            dl.retry(file);
+            break;
+        case ALPM_DOWNLOAD_COMPLETED: {
+            auto* completed = static_cast<alpm_download_event_completed_t*>(data);
+            dl.complete(file, completed ? completed->total : 0, completed && completed->result == 0);
+            break;
         }
     }
+
+    if (dl.due()) self->progress_cb_(dl.label(), dl.fraction());
 }
 
 void AlpmWrapper::event_callback(void* ctx, alpm_event_t* event) {
     auto* self = static_cast<AlpmWrapper*>(ctx);
-    if (!self->event_cb_ || !event) return;
+    if (!event) return;
+
+    /* sized up front for packages; db syncs learn sizes per file */
+    if (event->type == ALPM_EVENT_PKG_RETRIEVE_START)
+        self->downloads_.begin(event->pkg_retrieve.num, event->pkg_retrieve.total_size);
+    else if (event->type == ALPM_EVENT_DB_RETRIEVE_START)
+        self->downloads_.begin(0, 0);
+
+    if (!self->event_cb_) return;
 
     switch (event->type) {
         case ALPM_EVENT_CHECKDEPS_START:
@@ -576,6 +732,10 @@ void AlpmWrapper::event_callback(void* ctx, alpm_event_t* event) {
         case ALPM_EVENT_DB_RETRIEVE_START:
             self->event_cb_("Retrieving packages...");
             break;
+        case ALPM_EVENT_PKG_RETRIEVE_START:
+            self->event_cb_("Retrieving " + std::to_string(event->pkg_retrieve.num) + " packages (" +
+                            format_size(event->pkg_retrieve.total_size) + ")...");
+            break;
         default:
             break;
     }
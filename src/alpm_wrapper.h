@@ -1,10 +1,16 @@
 #pragma once
 #include "package.h"
 #include "pacman_conf.h"
+#include "pkg_index.h"
+#include "satisfier_index.h"
+#include "package_cache.h"
+#include "mirror_rank.h"
+#include "download_progress.h"
 #include <alpm.h>
 #include <string>
 #include <vector>
 #include <functional>
+#include <mutex>
 
 namespace pmt {
 
@@ -23,9 +29,10 @@ public:
     bool reload();
     std::string last_error() const { return last_error_; }
 
-    std::vector<PackageInfo> search(const std::string& query);
-    std::vector<PackageInfo> list_installed();
-    std::vector<PackageInfo> list_updates();
+    std::vector<PackageRow> search(const std::string& query);
+    std::vector<PackageRow> list_installed();
+    std::vector<PackageRow> list_updates();
+    PackageInfo package_details(const PackageRow& row);
     bool install_package(const std::string& name);
     bool remove_package(const std::string& name);
     bool system_upgrade();
@@ -37,8 +44,10 @@ public:
     void set_event_callback(EventCallback cb) { event_cb_ = std::move(cb); }
 
     bool is_root() const { return is_root_; }
-    void mark_installed(PackageInfo& info);
-    std::vector<PackageInfo> list_foreign();
+    void mark_installed(PackageRow& row);
+    std::vector<PackageRow> list_foreign();
+    void scan_local(std::vector<PackageRow>* foreign, std::vector<PackageRow>* updates);
+    void warm_sync_index();
     bool is_dep_satisfied(const std::string& depstring);
     bool is_dep_in_repos(const std::string& depstring);
 
@@ -49,7 +58,32 @@ private:
     ProgressCallback progress_cb_;
     EventCallback event_cb_;
     PacmanConfig saved_config_;
+    uint64_t generation_ = 0;
 
+    /* libalpm isn't thread-safe: every use of handle_ holds this. It is always taken
+       last, after index_mutex_ or satisfier_mutex_, and never held while waiting on them */
+    std::recursive_mutex handle_mutex_;
+
+    std::mutex index_mutex_;
+    PackageIndex sync_index_;
+    uint64_t index_gen_ = 0;
+
+    std::mutex satisfier_mutex_;
+    SatisfierIndex local_satisfiers_;
+    SatisfierIndex sync_satisfiers_;
+    uint64_t satisfier_gen_ = 0;
+
+    PackageCache pkg_cache_;
+    MirrorRanker mirrors_;
+    DownloadProgress downloads_;
+
+    void invalidate_caches();
+    void rank_mirrors();
+    PackageIndex& sync_index();
+    void refresh_satisfiers();
+
+    std::vector<PackageRow> search_regex(const std::string& query);
+    PackageRow pkg_to_row(alpm_pkg_t* pkg, const std::string& repo);
     PackageInfo pkg_to_info(alpm_pkg_t* pkg, const std::string& repo);
     static std::vector<std::string> list_to_strings(alpm_list_t* list);
     static std::vector<std::string> deplist_to_strings(alpm_list_t* list);
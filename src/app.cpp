@@ -1,36 +1,152 @@
 #include "app.h"
 #include "pacman_conf.h"
+#include "job_pool.h"
+#include "review_store.h"
+#include "perf.h"
 #include <signal.h>
+#include <glob.h>
 #include <unistd.h>
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <map>
 #include <set>
+#include <string_view>
+#include <unordered_map>
 
 namespace pmt {
 
-volatile bool App::resize_pending_ = false;
+namespace {
+
+/* a job's output, appended by its worker and drawn by the UI thread under mutex; only
+   the recent tail stays in memory, every line is mirrored to the file on disk */
+struct JobLog {
+    std::string path;
+    FILE* fp = nullptr;
+    std::mutex mutex;
+    LogBuffer lines;
+
+    void open(const std::string& file) {
+        path = file;
+        fp = fopen(path.c_str(), "w");
+    }
+
+    void append(const std::string& line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        lines.push(line);
+        if (fp) {
+            fputs(line.c_str(), fp);
+            fputc('\n', fp);
+            fflush(fp);
+        }
+    }
+
+    std::string last() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lines.empty() ? std::string() : lines.back();
+    }
+
+    LineSink sink() {
+        return [this](const std::string& line) { append(line); };
+    }
+
+    ~JobLog() { if (fp) fclose(fp); }
+};
+
+/* keeps the job view on a running job until the user picks one with Tab/Up/Down */
+void update_job_focus(const std::vector<JobLine>& jobs, const KeyEvent& ev,
+                      int& focused, bool& pinned) {
+    int n = static_cast<int>(jobs.size());
+    if (n == 0) return;
+    if (ev.key == Key::Tab || ev.key == Key::Down) {
+        focused = (focused + 1) % n;
+        pinned = true;
+    } else if (ev.key == Key::Up) {
+        focused = (focused + n - 1) % n;
+        pinned = true;
+    }
+    if (pinned || jobs[focused].state == JobLine::Running) return;
+    for (int i = 0; i < n; i++) {
+        if (jobs[i].state == JobLine::Running) {
+            focused = i;
+            break;
+        }
+    }
+}
+
+/* total make parallelism shared by concurrent builds: -jN from MAKEFLAGS, else the CPU count */
+int make_job_budget() {
+    const char* flags = getenv("MAKEFLAGS");
+    if (flags) {
+        std::string f = flags;
+        size_t pos = f.find("--jobs=");
+        if (pos != std::string::npos) pos += 7;
+        else if ((pos = f.find("-j")) != std::string::npos) pos += 2;
+        if (pos != std::string::npos) {
+            int n = atoi(f.c_str() + pos);
+            if (n > 0) return n;
+        }
+    }
+    return static_cast<int>(JobPool::default_workers());
+}
+
+size_t job_workers(int max_jobs, size_t pending) {
+    size_t workers = max_jobs > 0 ? static_cast<size_t>(max_jobs) : JobPool::default_workers();
+    return std::max<size_t>(1, std::min(workers, pending));
+}
+
+}
+
+volatile sig_atomic_t App::resize_pending_ = 0;
+Wakeup* App::resize_wakeup_ = nullptr;
 
 void App::sigwinch_handler(int) {
-    resize_pending_ = true;
+    resize_pending_ = 1;
+    if (resize_wakeup_) resize_wakeup_->notify();
 }
 
 App::App() : ui_(terminal_) {}
 
 App::~App() {
-    if (search_thread_.joinable()) search_thread_.join();
-    if (aur_search_thread_.joinable()) aur_search_thread_.join();
+    resize_wakeup_ = nullptr;
+    cancel_searches();
+    search_pool_.wait();
+    aur_search_pool_.wait();
 
     terminal_.show_cursor();
     terminal_.exit_alt_screen();
     terminal_.flush();
     terminal_.exit_raw_mode();
+
+    if (timing) print_timing();
+    perf::stop_trace();
+}
+
+void App::record_phase(const std::string& name, std::chrono::steady_clock::time_point begin) {
+    using ms = std::chrono::duration<double, std::milli>;
+    auto end = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(timing_mutex_);
+    phases_.push_back({name, ms(begin - start_time_).count(), ms(end - begin).count()});
 }
 
-/* initializes alpm, terminal, and background AUR connection */
+/* --timing: when each startup phase began and how long it took, relative to launch */
+void App::print_timing() {
+    std::lock_guard<std::mutex> lock(timing_mutex_);
+    std::sort(phases_.begin(), phases_.end(),
+              [](const Phase& a, const Phase& b) { return a.start_ms < b.start_ms; });
+    fprintf(stderr, "%-20s %10s %10s\n", "phase", "start ms", "took ms");
+    for (const auto& p : phases_)
+        fprintf(stderr, "%-20s %10.2f %10.2f\n", p.name.c_str(), p.start_ms, p.duration_ms);
+}
+
+/* initializes alpm and the terminal, draws the empty shell, then leaves the local DB,
+   sync DB caches and the AUR connection to background workers */
 bool App::init() {
     ui_.color_disabled = color_disabled;
+    if (!trace_path.empty() && !perf::start_trace(trace_path)) {
+        fprintf(stderr, "Error: Cannot write trace file %s\n", trace_path.c_str());
+        return false;
+    }
     if (!accent_hex.empty()) {
         const char* hex = accent_hex.c_str();
         if (hex[0] == '#') hex++;
@@ -40,18 +156,30 @@ bool App::init() {
         }
     }
 
+    auto phase_begin = std::chrono::steady_clock::now();
     PacmanConfig config;
     if (!config.parse()) {
         fprintf(stderr, "Error: Failed to parse /etc/pacman.conf\n");
         return false;
     }
+    record_phase("pacman.conf", phase_begin);
 
+    phase_begin = std::chrono::steady_clock::now();
     if (!alpm_.init(config)) {
         fprintf(stderr, "Error: %s\n", alpm_.last_error().c_str());
         return false;
     }
+    record_phase("alpm init", phase_begin);
+
+    aur_search_pool_.submit([this]() {
+        auto begin = std::chrono::steady_clock::now();
+        aur_.preconnect();
+        record_phase("aur preconnect", begin);
+    });
 
-    std::thread([this]() { aur_.preconnect(); }).detach();
+    ui_.detail_loader = [this](const PackageRow& row) {
+        return alpm_.package_details(row);
+    };
 
     alpm_.set_progress_callback([this](const std::string& label, double fraction) {
         ui_.progress.active = true;
@@ -70,46 +198,73 @@ bool App::init() {
     terminal_.hide_cursor();
     terminal_.flush();
 
+    resize_wakeup_ = &wakeup_;
     struct sigaction sa{};
     sa.sa_handler = sigwinch_handler;
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = SA_RESTART;
     sigaction(SIGWINCH, &sa, nullptr);
 
-    refresh_packages();
+    /* a write on a keep-alive socket the server already closed must fail, not kill us */
+    struct sigaction ign{};
+    ign.sa_handler = SIG_IGN;
+    sigemptyset(&ign.sa_mask);
+    sigaction(SIGPIPE, &ign, nullptr);
 
     if (!alpm_.is_root()) {
         set_status("Running without root - install/remove/upgrade requires sudo");
     }
 
+    phase_begin = std::chrono::steady_clock::now();
+    ui_.draw(packages_);
+    needs_redraw_ = false;
+    record_phase("first frame", phase_begin);
+
+    load_installed_async();
     return true;
 }
 
-/* main event loop */
+/* the installed list is handed to the main loop like a search result; the sync DB
+   caches load right behind it on the same worker, since libalpm can't populate
+   caches on one handle from two threads and searches run on this worker too */
+void App::load_installed_async() {
+    uint64_t gen = ++current_search_gen_;
+    search_wanted_gen_ = gen;
+    search_pool_.submit([this, gen]() {
+        if (search_wanted_gen_.load() == gen) {
+            auto begin = std::chrono::steady_clock::now();
+            auto rows = alpm_.list_installed();
+            record_phase("local db", begin);
+            {
+                std::lock_guard<std::mutex> lock(search_mutex_);
+                installed_buf_ = std::move(rows);
+            }
+            search_gen_ = gen;
+            installed_ready_ = true;
+            wakeup_.notify();
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        alpm_.warm_sync_index();
+        record_phase("sync db", begin);
+    });
+}
+
+/* main event loop; sleeps in poll until a key, a worker result, SIGWINCH or the
+   next debounce/status deadline, so an idle session costs no CPU */
 void App::run() {
     while (running_) {
         if (resize_pending_) {
-            resize_pending_ = false;
+            resize_pending_ = 0;
             terminal_.update_size();
             needs_redraw_ = true;
         }
 
-        if (!ui_.status_message.empty()) {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - status_set_time_).count();
-            if (elapsed >= STATUS_TIMEOUT_MS) {
-                ui_.status_message.clear();
-                needs_redraw_ = true;
-            }
-        }
-
         poll_search_results();
 
         if (!pending_search_.empty()) {
-            auto now = std::chrono::steady_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - last_search_time_).count();
+                std::chrono::steady_clock::now() - last_search_time_).count();
             if (elapsed >= DEBOUNCE_MS) {
                 std::string query = pending_search_;
                 pending_search_.clear();
@@ -117,20 +272,52 @@ void App::run() {
             }
         }
 
+        if (!ui_.status_message.empty()) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - status_set_time_).count();
+            if (elapsed >= STATUS_TIMEOUT_MS) {
+                ui_.status_message.clear();
+                needs_redraw_ = true;
+            }
+        }
+
         if (needs_redraw_) {
             ui_.draw(packages_);
             needs_redraw_ = false;
         }
 
-        auto ev = input_.read_key_timeout(16);
-        if (ev.key != Key::None) {
-            handle_key(ev);
-            drain_input();
-            needs_redraw_ = true;
+        aur_.set_keepalive(ui_.show_aur);
+
+        int ready = input_.wait(wakeup_.fd(), next_deadline_ms());
+        if (ready & Input::Woken) wakeup_.drain();
+        if (ready & Input::Hangup) {
+            running_ = false;
+        } else if (ready & Input::KeyReady) {
+            auto ev = input_.read_key_timeout(0);
+            if (ev.key != Key::None) {
+                handle_key(ev);
+                drain_input();
+                needs_redraw_ = true;
+            }
         }
     }
 }
 
+/* milliseconds until the pending debounce or status expiry fires, -1 if neither is armed */
+int App::next_deadline_ms() {
+    auto now = std::chrono::steady_clock::now();
+    long long timeout = -1;
+    auto arm = [&](std::chrono::steady_clock::time_point since, int delay_ms) {
+        auto left = delay_ms - std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - since).count();
+        if (left < 0) left = 0;
+        if (timeout < 0 || left < timeout) timeout = left;
+    };
+    if (!pending_search_.empty()) arm(last_search_time_, DEBOUNCE_MS);
+    if (!ui_.status_message.empty()) arm(status_set_time_, STATUS_TIMEOUT_MS);
+    return static_cast<int>(timeout);
+}
+
 void App::drain_input() {
     for (;;) {
         auto ev = input_.read_key_timeout(0);
@@ -139,22 +326,31 @@ void App::drain_input() {
     }
 }
 
+/* queued jobs and in-flight AUR streams check their generation against the wanted
+   one and bail out early, so a new query never waits behind a stale one */
+void App::cancel_searches() {
+    search_wanted_gen_ = 0;
+    aur_wanted_gen_ = 0;
+}
+
 void App::start_search(const std::string& query) {
     if (query.empty()) {
         refresh_packages();
         return;
     }
 
-    if (search_thread_.joinable()) search_thread_.join();
-    if (aur_search_thread_.joinable()) aur_search_thread_.join();
+    bool want_aur = ui_.show_aur;
+    uint64_t aur_gen = ++current_aur_gen_;
+    aur_wanted_gen_ = aur_gen;
 
     uint64_t gen = ++current_search_gen_;
+    search_wanted_gen_ = gen;
     search_ready_ = false;
-    bool want_aur = ui_.show_aur;
 
     set_status("Searching...");
 
-    search_thread_ = std::thread([this, query, gen]() {
+    search_pool_.submit([this, query, gen]() {
+        if (search_wanted_gen_.load() != gen) return;
         auto results = alpm_.search(query);
         {
             std::lock_guard<std::mutex> lock(search_mutex_);
@@ -162,50 +358,109 @@ void App::start_search(const std::string& query) {
         }
         search_gen_ = gen;
         search_ready_ = true;
+        wakeup_.notify();
     });
 
     if (want_aur) {
-        uint64_t aur_gen = ++current_aur_gen_;
-        aur_ready_ = false;
-        aur_search_thread_ = std::thread([this, query, aur_gen]() {
-            auto aur_results = aur_.search(query);
-            {
-                std::lock_guard<std::mutex> lock(search_mutex_);
-                aur_results_buf_ = std::move(aur_results);
-            }
-            aur_search_gen_ = aur_gen;
-            aur_ready_ = true;
+        begin_aur_stream();
+        aur_search_pool_.submit([this, query, aur_gen]() {
+            run_aur_search(query, aur_gen);
         });
+    } else {
+        aur_results_.reset();
     }
 }
 
 void App::start_aur_search(const std::string& query) {
-    if (aur_search_thread_.joinable()) aur_search_thread_.join();
-
     uint64_t gen = ++current_aur_gen_;
-    aur_ready_ = false;
+    aur_wanted_gen_ = gen;
 
     set_status("Searching AUR...");
 
-    aur_search_thread_ = std::thread([this, query, gen]() {
-        auto results = aur_.search(query);
+    begin_aur_stream();
+    aur_search_pool_.submit([this, query, gen]() {
+        run_aur_search(query, gen);
+    });
+}
+
+void App::begin_aur_stream() {
+    aur_ready_ = false;
+    std::lock_guard<std::mutex> lock(search_mutex_);
+    aur_results_buf_.clear();
+    aur_stream_done_ = false;
+    aur_snapshots_ = 0;
+}
+
+/* runs on an AUR search worker; rows are handed over as they are parsed, with
+   the main loop woken at most every AUR_PUBLISH_MS until the reply ends. The
+   generation is rechecked under the lock so a superseded stream can't leak rows
+   into the buffer of the query that replaced it */
+void App::run_aur_search(const std::string& query, uint64_t gen) {
+    if (aur_wanted_gen_.load() != gen) return;
+    auto last_publish = std::chrono::steady_clock::now();
+    aur_.search_stream(query, [&](PackageInfo&& info) {
+        if (aur_wanted_gen_.load() != gen) return false;
+        PackageRow row = make_row(std::move(info));
+        auto now = std::chrono::steady_clock::now();
+        bool publish = now - last_publish >= std::chrono::milliseconds(AUR_PUBLISH_MS);
         {
             std::lock_guard<std::mutex> lock(search_mutex_);
-            aur_results_buf_ = std::move(results);
+            if (aur_wanted_gen_.load() != gen) return false;
+            aur_results_buf_.push_back(std::move(row));
+            if (publish) {
+                aur_search_gen_ = gen;
+                aur_ready_ = true;
+            }
         }
+        if (publish) {
+            last_publish = now;
+            wakeup_.notify();
+        }
+        return true;
+    });
+    {
+        std::lock_guard<std::mutex> lock(search_mutex_);
+        if (aur_wanted_gen_.load() != gen) return;
+        aur_stream_done_ = true;
         aur_search_gen_ = gen;
         aur_ready_ = true;
-    });
+    }
+    wakeup_.notify();
+}
+
+std::vector<PackageRow> App::search_aur_rows(const std::string& query) {
+    auto infos = aur_.search(query);
+    std::vector<PackageRow> rows;
+    rows.reserve(infos.size());
+    for (auto& info : infos)
+        rows.push_back(make_row(std::move(info)));
+    return rows;
 }
 
 void App::poll_search_results() {
+    if (installed_ready_.load()) {
+        installed_ready_ = false;
+        if (search_gen_.load() == current_search_gen_) {
+            auto begin = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(search_mutex_);
+                packages_ = PackageList(std::move(installed_buf_));
+                installed_buf_.clear();
+            }
+            apply_sort();
+            ui_.draw(packages_);
+            needs_redraw_ = false;
+            record_phase("installed list", begin);
+        }
+    }
+
     if (search_ready_.load()) {
         search_ready_ = false;
         if (search_gen_.load() == current_search_gen_) {
             std::lock_guard<std::mutex> lock(search_mutex_);
-            repo_results_ = std::move(search_results_buf_);
+            repo_results_ = std::make_shared<const ResultSet>(std::move(search_results_buf_));
             if (!ui_.show_aur) {
-                packages_ = repo_results_;
+                packages_ = PackageList(repo_results_);
                 apply_sort();
                 ui_.selected = 0;
                 ui_.list_scroll = 0;
@@ -219,17 +474,51 @@ void App::poll_search_results() {
     if (aur_ready_.load()) {
         aur_ready_ = false;
         if (aur_search_gen_.load() == current_aur_gen_) {
-            std::lock_guard<std::mutex> lock(search_mutex_);
-            aur_results_ = std::move(aur_results_buf_);
-            for (auto& pkg : aur_results_)
-                alpm_.mark_installed(pkg);
+            bool done;
+            std::vector<PackageRow> delta;
+            {
+                std::lock_guard<std::mutex> lock(search_mutex_);
+                done = aur_stream_done_;
+                delta = std::move(aur_results_buf_);
+                aur_results_buf_.clear();
+            }
+            for (auto& pkg : delta) alpm_.mark_installed(pkg);
+
+            bool first = aur_snapshots_++ == 0;
+
+            /* re-sorting moves rows around, so the selection follows the package, not the index */
+            std::string selected_name, selected_repo;
+            if (ui_.show_aur && !first && ui_.selected >= 0 &&
+                ui_.selected < static_cast<int>(packages_.size())) {
+                selected_name = packages_[ui_.selected].name;
+                selected_repo = packages_[ui_.selected].repo;
+            }
+
+            /* drop the view's reference first so the previous snapshot's rows can be moved */
+            if (ui_.show_aur) packages_ = PackageList();
+            aur_results_ = ResultSet::extend(first ? nullptr : std::move(aur_results_), std::move(delta));
+
             if (ui_.show_aur) {
-                packages_ = aur_results_;
+                packages_ = PackageList(aur_results_);
                 apply_sort();
-                ui_.selected = 0;
-                ui_.list_scroll = 0;
-                ui_.detail_scroll = 0;
-                if (aur_results_.empty() && !aur_.last_error().empty()) {
+                if (first) {
+                    ui_.selected = 0;
+                    ui_.list_scroll = 0;
+                    ui_.detail_scroll = 0;
+                } else if (!selected_name.empty()) {
+                    for (size_t i = 0; i < packages_.size(); ++i) {
+                        if (packages_[i].name == selected_name && packages_[i].repo == selected_repo) {
+                            ui_.selected = static_cast<int>(i);
+                            break;
+                        }
+                    }
+                    ui_.ensure_visible();
+                } else if (ui_.selected >= static_cast<int>(packages_.size())) {
+                    ui_.selected = packages_.empty() ? 0 : static_cast<int>(packages_.size()) - 1;
+                }
+                if (!done) {
+                    ui_.status_message = "Searching AUR... (" + std::to_string(aur_results_->size()) + ")";
+                } else if (aur_results_->empty() && !aur_.last_error().empty()) {
                     ui_.status_message = "AUR: " + aur_.last_error();
                 } else {
                     ui_.status_message.clear();
@@ -314,7 +603,7 @@ void App::handle_search_key(const KeyEvent& ev) {
             ui_.show_aur = !ui_.show_aur;
             if (!ui_.search_text.empty()) {
                 if (ui_.show_aur) {
-                    if (aur_results_.empty()) {
+                    if (!aur_results_ || aur_results_->empty()) {
                         start_aur_search(ui_.search_text);
                     } else {
                         update_display_list();
@@ -390,6 +679,10 @@ void App::handle_list_key(const KeyEvent& ev) {
                 case 'c':
                     do_clear_cache();
                     break;
+                case 'P':
+                    ui_.perf_overlay = !ui_.perf_overlay;
+                    perf::set_enabled(ui_.perf_overlay);
+                    break;
                 case 's': {
                     std::vector<std::string> opts = {
                         "Name",
@@ -461,7 +754,7 @@ void App::handle_list_key(const KeyEvent& ev) {
             ui_.filter_installed = false;
             ui_.filter_updates = false;
             if (!ui_.search_text.empty()) {
-                if (ui_.show_aur && aur_results_.empty()) {
+                if (ui_.show_aur && (!aur_results_ || aur_results_->empty())) {
                     start_aur_search(ui_.search_text);
                 } else {
                     update_display_list();
@@ -470,6 +763,7 @@ void App::handle_list_key(const KeyEvent& ev) {
             break;
 
         case Key::CtrlL:
+            terminal_.invalidate();
             needs_redraw_ = true;
             break;
 
@@ -530,13 +824,16 @@ void App::do_search_sync(const std::string& query) {
         return;
     }
 
-    repo_results_ = alpm_.search(query);
-    aur_results_.clear();
+    repo_results_ = std::make_shared<const ResultSet>(alpm_.search(query));
+    aur_results_.reset();
+    /* supersedes any stream still running, so its snapshots can't extend these results */
+    aur_wanted_gen_ = ++current_aur_gen_;
 
     if (ui_.show_aur) {
-        aur_results_ = aur_.search(query);
-        for (auto& pkg : aur_results_)
+        auto aur_rows = search_aur_rows(query);
+        for (auto& pkg : aur_rows)
             alpm_.mark_installed(pkg);
+        aur_results_ = std::make_shared<const ResultSet>(std::move(aur_rows));
     }
 
     update_display_list();
@@ -556,7 +853,7 @@ void App::do_install() {
         return;
     }
 
-    if (search_thread_.joinable()) search_thread_.join();
+    search_pool_.wait();
 
     bool ok;
     if (pkg.source == PackageSource::AUR) {
@@ -603,7 +900,7 @@ void App::do_install() {
             return;
         }
 
-        ok = run_aur_builds(build_order, dep_result.repo_deps, pkg.name);
+        ok = run_aur_builds(build_order, dep_result.build_deps, dep_result.repo_deps, pkg.name);
     } else {
         std::vector<std::string> lines;
         lines.push_back("Package: " + pkg.repo + "/" + pkg.name + " " + pkg.version);
@@ -660,7 +957,7 @@ void App::do_remove() {
         return;
     }
 
-    if (search_thread_.joinable()) search_thread_.join();
+    search_pool_.wait();
 
     set_status("Removing " + pkg.name + "...");
     ui_.progress.active = true;
@@ -695,7 +992,7 @@ void App::do_downgrade() {
         return;
     }
 
-    if (search_thread_.joinable()) search_thread_.join();
+    search_pool_.wait();
 
     auto cached = alpm_.list_cached_versions(pkg.name);
     if (cached.empty()) {
@@ -759,7 +1056,7 @@ void App::do_upgrade() {
         return;
     }
 
-    if (search_thread_.joinable()) search_thread_.join();
+    search_pool_.wait();
 
     set_status("Syncing databases...");
     ui_.draw(packages_);
@@ -810,7 +1107,7 @@ void App::do_sync() {
         return;
     }
 
-    if (search_thread_.joinable()) search_thread_.join();
+    search_pool_.wait();
 
     set_status("Syncing databases...");
     ui_.draw(packages_);
@@ -830,7 +1127,7 @@ void App::do_filter_installed() {
     ui_.show_aur = false;
 
     if (ui_.filter_installed) {
-        packages_ = alpm_.list_installed();
+        packages_ = PackageList(alpm_.list_installed());
         apply_sort();
     } else {
         if (!ui_.search_text.empty()) {
@@ -851,7 +1148,7 @@ void App::do_filter_updates() {
     ui_.show_aur = false;
 
     if (ui_.filter_updates) {
-        packages_ = alpm_.list_updates();
+        packages_ = PackageList(alpm_.list_updates());
         apply_sort();
         if (packages_.empty()) {
             set_status("No updates available");
@@ -898,35 +1195,34 @@ void App::do_clear_cache() {
     uintmax_t total_freed = 0;
     int files_removed = 0;
 
+    for (const char* dir : {"/tmp/pmt_build", "/tmp/pmt_vcs"}) {
+        for (auto& f : fs::directory_iterator(dir, ec))
+            if (f.is_regular_file(ec)) temp_logs.push_back(f.path().string());
+    }
+
     if (choice == 0) {
         if (!fs::exists(cache_dir, ec) || !fs::is_directory(cache_dir, ec)) {
             set_status("Nothing to clear — build cache is empty");
             return;
         }
 
-        struct PkgFile {
-            fs::path path;
-            fs::file_time_type mtime;
-            uintmax_t size;
-        };
-
-        std::vector<PkgFile> to_delete;
+        /* split packages share a build directory, so builds are counted per package name */
+        std::vector<std::string> build_dirs;
+        for (auto& pkg_entry : fs::directory_iterator(cache_dir, ec))
+            if (pkg_entry.is_directory(ec)) build_dirs.push_back(pkg_entry.path().string());
+        build_cache_.set_dirs(build_dirs);
+        build_cache_.refresh();
 
-        for (auto& pkg_entry : fs::directory_iterator(cache_dir, ec)) {
-            if (!pkg_entry.is_directory(ec)) continue;
-
-            std::vector<PkgFile> pkg_files;
-            for (auto& f : fs::directory_iterator(pkg_entry.path(), ec)) {
-                if (!f.is_regular_file(ec)) continue;
-                std::string name = f.path().filename().string();
-                if (name.find(".pkg.tar") == std::string::npos) continue;
-                pkg_files.push_back({f.path(), f.last_write_time(ec), f.file_size(ec)});
-            }
+        std::map<std::string, std::vector<CachedPackage>> by_name;
+        for (auto& pkg : build_cache_.all())
+            by_name[pkg.name].push_back(std::move(pkg));
 
+        std::vector<CachedPackage> to_delete;
+        for (auto& [name, pkg_files] : by_name) {
             if (pkg_files.size() <= 2) continue;
 
             std::sort(pkg_files.begin(), pkg_files.end(),
-                      [](const PkgFile& a, const PkgFile& b) { return a.mtime > b.mtime; });
+                      [](const CachedPackage& a, const CachedPackage& b) { return a.mtime > b.mtime; });
 
             for (size_t i = 2; i < pkg_files.size(); i++) {
                 total_freed += pkg_files[i].size;
@@ -942,7 +1238,7 @@ void App::do_clear_cache() {
         std::vector<std::string> confirm_lines;
         confirm_lines.push_back("Files to remove: " + std::to_string(to_delete.size()));
         confirm_lines.push_back("Space to free: " + format_size(static_cast<int64_t>(total_freed)));
-        confirm_lines.push_back("Keeps 2 newest packages per directory");
+        confirm_lines.push_back("Keeps the 2 newest builds of each package");
 
         if (!ui_.draw_confirm_dialog("Clean Build Cache", confirm_lines)) {
             set_status("Cache clear cancelled");
@@ -1035,6 +1331,7 @@ void App::do_clear_cache() {
 
         fs::remove_all(cache_dir, ec);
         fs::remove_all(reviewed_dir, ec);
+        aur_.clear_metadata_cache();
         for (const auto& log : temp_logs)
             fs::remove(log, ec);
 
@@ -1044,199 +1341,379 @@ void App::do_clear_cache() {
 
 /* shared AUR build pipeline: PKGBUILD review, dep install, build loop */
 bool App::run_aur_builds(const std::vector<PackageInfo>& build_order,
+                         const BuildGraph& build_deps,
                          const std::vector<std::string>& repo_deps,
                          const std::string& summary_name) {
     int total_builds = static_cast<int>(build_order.size());
 
     namespace fs = std::filesystem;
-    std::string reviewed_dir = AurClient::reviewed_cache_dir();
+    ReviewStore review_store(AurClient::reviewed_cache_dir());
 
-    for (const auto& p : build_order) {
-        set_status("Fetching PKGBUILD for " + p.name + "...");
-        ui_.draw(packages_);
+    /* every clone/pull starts now, so later repos are fetched while earlier PKGBUILDs
+       are being reviewed; the builds then reuse exactly these checkouts */
+    struct Fetch {
+        std::string pkgbuild;
+        ReviewStore::Snapshot snapshot;
+        std::atomic<bool> done{false};
+    };
+    std::vector<Fetch> fetches(build_order.size());
+    std::atomic<bool> fetch_cancelled{false};
+    JobPool fetch_pool(job_workers(max_jobs, build_order.size()));
+    for (size_t i = 0; i < build_order.size(); i++) {
+        fetch_pool.submit([this, &build_order, &fetches, &fetch_cancelled, i]() {
+            if (!fetch_cancelled) {
+                try {
+                    const auto& p = build_order[i];
+                    fetches[i].pkgbuild = aur_.fetch_pkgbuild(p.name, p.pkgbase);
+                    if (!fetches[i].pkgbuild.empty()) {
+                        std::string base = (!p.pkgbase.empty() && p.pkgbase != p.name) ? p.pkgbase : p.name;
+                        auto tracked = aur_.tracked_files(p.name, p.pkgbase);
+                        if (tracked.empty()) tracked.push_back("PKGBUILD");
+                        fetches[i].snapshot = ReviewStore::scan(AurClient::default_cache_dir() + "/" + base,
+                                                                std::move(tracked));
+                    }
+                } catch (...) {
+                }
+            }
+            fetches[i].done = true;
+        });
+    }
+
+    for (size_t i = 0; i < build_order.size(); i++) {
+        const auto& p = build_order[i];
+        while (!fetches[i].done) {
+            size_t ready = 0;
+            for (const auto& f : fetches) ready += f.done ? 1 : 0;
+            set_status("Fetching PKGBUILD for " + p.name + "... (" + std::to_string(ready)
+                       + "/" + std::to_string(fetches.size()) + " ready)");
+            ui_.draw(packages_);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
 
-        std::string pkgbuild = aur_.fetch_pkgbuild(p.name, p.pkgbase);
+        const std::string& pkgbuild = fetches[i].pkgbuild;
         if (pkgbuild.empty()) {
+            fetch_cancelled = true;
             set_status("Failed to fetch PKGBUILD for " + p.name);
             ui_.progress.active = false;
             return false;
         }
 
+        /* an identical tree was approved before (or by a split sibling just now) */
         std::string base = (!p.pkgbase.empty() && p.pkgbase != p.name) ? p.pkgbase : p.name;
-        std::string reviewed_path = reviewed_dir + "/" + base + "/PKGBUILD";
-        std::string old_pkgbuild;
-        {
-            std::ifstream f(reviewed_path);
-            if (f) {
-                old_pkgbuild = std::string((std::istreambuf_iterator<char>(f)),
-                                            std::istreambuf_iterator<char>());
+        const auto& snapshot = fetches[i].snapshot;
+        if (review_store.is_reviewed(base, snapshot)) continue;
+
+        std::string checkout = AurClient::default_cache_dir() + "/" + base;
+        for (const auto& path : review_store.changed_files(base, snapshot)) {
+            /* generated from the PKGBUILD, which is reviewed itself */
+            if (path == ".SRCINFO") continue;
+
+            std::string content = path == "PKGBUILD" ? pkgbuild : ReviewStore::display_content(checkout, path);
+            if (content.find('\0') != std::string::npos)
+                content = "(binary file, " + format_size(static_cast<int64_t>(content.size())) + ")\n";
+            std::string old_content = review_store.reviewed_content(base, path);
+            if (old_content == content)
+                old_content.clear();
+
+            std::string title = path == "PKGBUILD" ? p.name : p.name + "/" + path;
+            if (!ui_.draw_pkgbuild_review(title, content, old_content)) {
+                fetch_cancelled = true;
+                set_status("Build cancelled (" + path + " rejected for " + p.name + ")");
+                ui_.progress.active = false;
+                return false;
             }
         }
-        if (old_pkgbuild == pkgbuild)
-            old_pkgbuild.clear();
-
-        if (!ui_.draw_pkgbuild_review(p.name, pkgbuild, old_pkgbuild)) {
-            set_status("Build cancelled (PKGBUILD rejected for " + p.name + ")");
-            ui_.progress.active = false;
-            return false;
-        }
 
         try {
-            fs::create_directories(reviewed_dir + "/" + base);
-            std::ofstream out(reviewed_path);
-            if (out) out << pkgbuild;
-
-            const char* sudo_user = getenv("SUDO_USER");
-            if (geteuid() == 0 && sudo_user && sudo_user[0]) {
-                std::string cmd = "chown -R '" + std::string(sudo_user) + "' '"
-                                  + reviewed_dir + "/" + base + "'";
-                system(cmd.c_str());
-            }
+            review_store.record(base, checkout, snapshot);
         } catch (...) {
         }
     }
 
-    std::string log_file = "/tmp/pmt_build.log";
-    { FILE* f = fopen(log_file.c_str(), "w"); if (f) fclose(f); }
-
-    FILE* log_fp = fopen(log_file.c_str(), "r");
+    JobLog main_log;
+    main_log.open("/tmp/pmt_build.log");
     auto start_time = std::chrono::steady_clock::now();
-    std::vector<std::string> log_lines;
-
-    auto tail_log = [&]() {
-        if (!log_fp) return;
-        clearerr(log_fp);
-        char buf[4096];
-        while (fgets(buf, sizeof(buf), log_fp)) {
-            std::string line(buf);
-            if (!line.empty() && line.back() == '\n') line.pop_back();
-            log_lines.push_back(std::move(line));
-        }
-    };
 
     auto elapsed = [&]() -> int {
         return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::steady_clock::now() - start_time).count());
     };
 
-    auto run_tailed = [&](const std::string& cmd, const std::string& title) -> int {
+    auto draw_main_log = [&](const std::string& title, bool finished) {
+        std::lock_guard<std::mutex> lock(main_log.mutex);
+        ui_.draw_build_log(title, main_log.lines, finished, elapsed());
+    };
+
+    if (!repo_deps.empty()) {
+        main_log.append("=== Installing repo dependencies ===");
+
+        std::vector<std::string> argv = {"pacman", "-S", "--needed", "--noconfirm", "--asdeps"};
+        argv.insert(argv.end(), repo_deps.begin(), repo_deps.end());
+
         std::atomic<bool> done{false};
-        int rc = 0;
+        ProcessResult res;
         std::thread t([&]() {
-            rc = system(cmd.c_str());
+            res = run_process(argv, main_log.sink());
             done = true;
         });
         while (!done.load()) {
-            tail_log();
-            ui_.draw_build_log(title, log_lines, false, elapsed());
+            draw_main_log("Installing dependencies", false);
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         t.join();
-        tail_log();
-        return rc;
-    };
 
-    if (!repo_deps.empty()) {
-        log_lines.push_back("=== Installing repo dependencies ===");
-
-        std::string dep_list;
-        for (const auto& d : repo_deps) {
-            if (!dep_list.empty()) dep_list += " ";
-            dep_list += d;
-        }
-        std::string cmd = "pacman -S --needed --noconfirm --asdeps " + dep_list +
-                          " >> '" + log_file + "' 2>&1";
-        int rc = run_tailed(cmd, "Installing dependencies");
-        if (rc != 0) {
-            log_lines.push_back("FAILED to install repo dependencies");
-            ui_.draw_build_log("Installing dependencies - FAILED", log_lines, true, elapsed());
+        if (!res.ok()) {
+            main_log.append("FAILED to install repo dependencies");
+            draw_main_log("Installing dependencies - FAILED", true);
             drain_input();
             for (;;) {
                 auto ev = input_.read_key_timeout(100);
                 if (ev.key != Key::None) break;
             }
-            if (log_fp) fclose(log_fp);
             ui_.progress.active = false;
             return false;
         }
     }
 
-    for (int idx = 0; idx < total_builds; idx++) {
-        const auto& p = build_order[idx];
-
-        std::string title = "Building " + p.name;
-        if (total_builds > 1)
-            title += " [" + std::to_string(idx + 1) + "/" + std::to_string(total_builds) + "]";
+    /* one node per pkgbase; a node is released once every build dep it has is installed */
+    enum Stage { Waiting, Queued, Building, Built, Installing, Installed, Failed, Skipped };
+    struct BuildJob {
+        const PackageInfo* pkg = nullptr;
+        std::string base;
+        std::vector<size_t> deps;
+        JobLog log;
+        std::atomic<int> stage{Waiting};
+        std::string detail;
+    };
 
-        log_lines.push_back("");
-        log_lines.push_back("=== Building " + p.name + " ===");
+    std::error_code ec;
+    std::string build_log_dir = "/tmp/pmt_build";
+    fs::create_directories(build_log_dir, ec);
+
+    std::vector<BuildJob> jobs(build_order.size());
+    std::map<std::string, size_t> job_of;
+    for (size_t i = 0; i < build_order.size(); i++) {
+        const auto& p = build_order[i];
+        jobs[i].pkg = &p;
+        jobs[i].base = p.pkgbase.empty() ? p.name : p.pkgbase;
+        job_of[jobs[i].base] = i;
+    }
+    for (auto& job : jobs) {
+        auto it = build_deps.find(job.base);
+        if (it != build_deps.end()) {
+            for (const auto& dep : it->second) {
+                auto d = job_of.find(dep);
+                if (d != job_of.end()) job.deps.push_back(d->second);
+            }
+        }
+        job.log.open(build_log_dir + "/" + job.base + ".log");
+    }
 
-        std::atomic<bool> build_done{false};
-        std::string built_path;
-        std::thread build_thread([&]() {
-            built_path = aur_.build_package(p.name, log_file, "", p.pkgbase);
-            build_done = true;
-        });
+    size_t workers = job_workers(max_jobs, jobs.size());
+    int make_jobs = std::max(1, make_job_budget() / static_cast<int>(workers));
+
+    /* pacman takes one database lock, so installs run one at a time */
+    std::mutex install_mutex;
+    std::atomic<bool> cancelled{false};
+    auto run_job = [this, &install_mutex, &cancelled, make_jobs](BuildJob& job) {
+        job.stage = Building;
+        if (cancelled) {
+            job.detail = "cancelled";
+            job.stage = Skipped;
+            return;
+        }
+        std::string built_path = aur_.build_package(job.pkg->name, job.log.sink(), "",
+                                                    job.pkg->pkgbase, make_jobs, true);
+        if (built_path.empty()) {
+            job.log.append(cancelled ? "Build cancelled" : "BUILD FAILED for " + job.pkg->name);
+            job.detail = "build failed";
+            job.stage = Failed;
+            return;
+        }
 
-        while (!build_done.load()) {
-            tail_log();
-            ui_.draw_build_log(title, log_lines, false, elapsed());
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        job.stage = Built;
+        std::lock_guard<std::mutex> lock(install_mutex);
+        job.stage = Installing;
+        job.log.append("=== Installing " + job.pkg->name + " ===");
+        std::string pkg_dir = built_path.substr(0, built_path.rfind('/'));
+        std::vector<std::string> argv = {"pacman", "-U", "--noconfirm", "--overwrite", "*"};
+        glob_t g{};
+        if (glob((pkg_dir + "/*.pkg.tar*").c_str(), 0, nullptr, &g) == 0) {
+            for (size_t i = 0; i < g.gl_pathc; i++) argv.push_back(g.gl_pathv[i]);
+        }
+        globfree(&g);
+        /* no cancel token: interrupting pacman mid-transaction is worse than waiting */
+        if (!run_process(argv, job.log.sink()).ok()) {
+            job.log.append("INSTALL FAILED for " + job.pkg->name);
+            job.detail = "install failed";
+            job.stage = Failed;
+            return;
         }
-        build_thread.join();
-        tail_log();
+        job.stage = Installed;
+    };
 
-        if (built_path.empty()) {
-            log_lines.push_back("");
-            log_lines.push_back("BUILD FAILED for " + p.name);
-            ui_.draw_build_log(title + " - FAILED", log_lines, true, elapsed());
-            drain_input();
-            for (;;) {
-                auto ev = input_.read_key_timeout(100);
-                if (ev.key != Key::None) break;
+    std::string title = total_builds > 1
+        ? "Building " + std::to_string(total_builds) + " AUR packages ["
+              + std::to_string(workers) + " jobs, MAKEFLAGS=-j" + std::to_string(make_jobs) + "]"
+        : "Building " + build_order[0].name;
+    std::vector<JobLine> job_lines(jobs.size());
+    int focused = 0;
+    bool focus_pinned = false;
+    int installed = 0;
+    int failed = 0;
+
+    {
+        JobPool pool(workers);
+        KeyEvent ev;
+        drain_input();
+        for (;;) {
+            for (auto& job : jobs) {
+                if (job.stage != Waiting) continue;
+                bool ready = true;
+                for (size_t d : job.deps) {
+                    int st = jobs[d].stage;
+                    if (st == Failed || st == Skipped) {
+                        job.detail = "skipped (" + jobs[d].base + " failed)";
+                        job.log.append("Skipping " + job.pkg->name + ": dependency " + jobs[d].base + " failed");
+                        job.stage = Skipped;
+                        break;
+                    }
+                    if (st != Installed) ready = false;
+                }
+                if (job.stage == Waiting && cancelled) {
+                    job.detail = "cancelled";
+                    job.stage = Skipped;
+                } else if (job.stage == Waiting && ready) {
+                    job.stage = Queued;
+                    pool.submit([&run_job, &job]() { run_job(job); });
+                }
             }
-            if (log_fp) fclose(log_fp);
-            return false;
-        }
 
-        log_lines.push_back("");
-        log_lines.push_back("=== Installing " + p.name + " ===");
+            /* split packages pool their edges per pkgbase, which can close a cycle the
+               name-level ordering never saw; with nothing left to finish, waiting jobs never start */
+            bool active = false;
+            std::string stalled;
+            for (const auto& job : jobs) {
+                int st = job.stage;
+                if (st == Queued || st == Building || st == Built || st == Installing) active = true;
+                if (st == Waiting) stalled += (stalled.empty() ? "" : ", ") + job.base;
+            }
+            if (!active && !stalled.empty()) {
+                for (auto& job : jobs) {
+                    if (job.stage != Waiting) continue;
+                    job.detail = "dependency cycle between " + stalled;
+                    job.log.append("Cannot build " + job.pkg->name + ": dependency cycle between " + stalled);
+                    job.stage = Failed;
+                }
+            }
 
-        std::string pkg_dir = built_path.substr(0, built_path.rfind('/'));
-        std::string install_cmd = "pacman -U --noconfirm --overwrite '*' " +
-                                  pkg_dir + "/*.pkg.tar* >> '" + log_file + "' 2>&1";
-        int rc = run_tailed(install_cmd, title + " (installing)");
-        if (rc != 0) {
-            log_lines.push_back("INSTALL FAILED for " + p.name);
-            ui_.draw_build_log(title + " - FAILED", log_lines, true, elapsed());
-            drain_input();
-            for (;;) {
-                auto ev = input_.read_key_timeout(100);
-                if (ev.key != Key::None) break;
+            bool all_done = true;
+            installed = failed = 0;
+            for (size_t i = 0; i < jobs.size(); i++) {
+                auto& job = jobs[i];
+                auto& line = job_lines[i];
+                line.name = job.base;
+                switch (job.stage.load()) {
+                    case Waiting: {
+                        line.state = JobLine::Queued;
+                        line.detail = "waiting for";
+                        for (size_t d : job.deps)
+                            if (jobs[d].stage != Installed) line.detail += " " + jobs[d].base;
+                        all_done = false;
+                        break;
+                    }
+                    case Queued:
+                        line.state = JobLine::Queued;
+                        line.detail = "queued";
+                        all_done = false;
+                        break;
+                    case Building:
+                        line.state = JobLine::Running;
+                        line.detail = job.log.last();
+                        if (line.detail.empty()) line.detail = "building";
+                        all_done = false;
+                        break;
+                    case Built:
+                        line.state = JobLine::Running;
+                        line.detail = "built, waiting to install";
+                        all_done = false;
+                        break;
+                    case Installing:
+                        line.state = JobLine::Running;
+                        line.detail = "installing";
+                        all_done = false;
+                        break;
+                    case Installed:
+                        line.state = JobLine::Done;
+                        line.detail = "installed";
+                        installed++;
+                        break;
+                    default:
+                        line.state = JobLine::Failed;
+                        line.detail = job.detail;
+                        failed++;
+                        break;
+                }
             }
-            if (log_fp) fclose(log_fp);
-            return false;
-        }
 
-        alpm_.reload();
+            update_job_focus(job_lines, ev, focused, focus_pinned);
+            {
+                std::lock_guard<std::mutex> lock(jobs[focused].log.mutex);
+                ui_.draw_job_log(title, job_lines, focused, jobs[focused].log.lines, all_done, elapsed());
+            }
+            if (all_done) break;
+
+            ev = input_.read_key_timeout(100);
+            if (ev.key == Key::CtrlC && !cancelled) {
+                cancelled = true;
+                aur_.cancel_commands(true);
+                title += " - cancelling";
+            }
+        }
+        pool.wait();
     }
 
-    if (log_fp) fclose(log_fp);
+    aur_.cancel_commands(false);
+    if (installed > 0) alpm_.reload();
 
     terminal_.enter_raw_mode();
     terminal_.hide_cursor();
+    terminal_.invalidate();
+
+    if (failed > 0) {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            if (jobs[i].stage == Failed) {
+                focused = static_cast<int>(i);
+                break;
+            }
+        }
+        title = "Build failed: " + std::to_string(failed) + " of " + std::to_string(total_builds)
+              + " not installed (Tab/↑↓ logs, Enter to close)";
+        drain_input();
+        for (;;) {
+            ui_.draw_job_log(title, job_lines, focused, jobs[focused].log.lines, true, elapsed());
+            auto ev = input_.read_key();
+            if (ev.key == Key::Enter || ev.key == Key::Escape || ev.key == Key::CtrlC ||
+                (ev.key == Key::Char && ev.ch == 'q'))
+                break;
+            focus_pinned = true;
+            update_job_focus(job_lines, ev, focused, focus_pinned);
+        }
+        return false;
+    }
 
-    log_lines.push_back("");
-    log_lines.push_back("=== Build complete ===");
+    main_log.append("");
+    main_log.append("=== Build complete ===");
+    for (const auto& job : jobs)
+        main_log.append(job.pkg->name + " " + job.pkg->version + ": installed");
     std::string success_msg = "Successfully built and installed " + summary_name;
     if (total_builds > 1)
         success_msg += " (" + std::to_string(total_builds) + " AUR packages)";
-    log_lines.push_back(success_msg);
-    log_lines.push_back("");
-    log_lines.push_back("Press any key to continue...");
+    main_log.append(success_msg);
+    main_log.append("");
+    main_log.append("Press any key to continue...");
 
-    std::string final_title = "Build complete: " + summary_name;
-    ui_.draw_build_log(final_title, log_lines, true, elapsed());
+    draw_main_log("Build complete: " + summary_name, true);
 
     drain_input();
     for (;;) {
@@ -1263,12 +1740,12 @@ void App::do_aur_upgrade() {
         return;
     }
 
-    dbglog("is root, joining search threads...");
+    dbglog("is root, waiting for search workers...");
 
-    if (search_thread_.joinable()) search_thread_.join();
-    dbglog("search_thread joined");
-    if (aur_search_thread_.joinable()) aur_search_thread_.join();
-    dbglog("aur_search_thread joined");
+    search_pool_.wait();
+    dbglog("search worker idle");
+    aur_search_pool_.wait();
+    dbglog("aur search worker idle");
 
     set_status("Checking foreign packages...");
     ui_.draw(packages_);
@@ -1296,15 +1773,16 @@ void App::do_aur_upgrade() {
     fflush(dbg);
 
     dbglog("calling info_batch...");
-    auto aur_info = aur_.info_batch(names);
+    auto aur_info = aur_.info_batch(names, true);
     fprintf(dbg, "info_batch returned %zu packages\n", aur_info.size());
     fflush(dbg);
 
-    std::map<std::string, PackageInfo> aur_map;
-    for (auto& p : aur_info)
-        aur_map[p.name] = std::move(p);
+    std::unordered_map<std::string_view, const PackageInfo*> aur_map;
+    aur_map.reserve(aur_info.size());
+    for (const auto& p : aur_info)
+        aur_map.emplace(p.name, &p);
 
-    std::vector<std::pair<PackageInfo, PackageInfo>> upgrades;
+    std::vector<std::pair<PackageRow, PackageInfo>> upgrades;
     for (const auto& local : foreign) {
         auto it = aur_map.find(local.name);
         if (it == aur_map.end()) {
@@ -1312,7 +1790,7 @@ void App::do_aur_upgrade() {
             continue;
         }
 
-        const auto& aur_pkg = it->second;
+        const auto& aur_pkg = *it->second;
         int cmp = alpm_pkg_vercmp(aur_pkg.version.c_str(), local.version.c_str());
         fprintf(dbg, "  %s: local=%s aur=%s cmp=%d\n",
                 local.name.c_str(), local.version.c_str(),
@@ -1326,12 +1804,12 @@ void App::do_aur_upgrade() {
     fprintf(dbg, "upgrades found: %zu\n", upgrades.size());
     fflush(dbg);
 
-    std::vector<std::pair<PackageInfo, PackageInfo>> vcs_candidates;
+    std::vector<std::pair<PackageRow, PackageInfo>> vcs_candidates;
     for (const auto& local : foreign) {
         if (!AurClient::is_vcs_package(local.name)) continue;
         auto it = aur_map.find(local.name);
         if (it == aur_map.end()) continue;
-        const auto& aur_pkg = it->second;
+        const auto& aur_pkg = *it->second;
         int cmp = alpm_pkg_vercmp(aur_pkg.version.c_str(), local.version.c_str());
         if (cmp <= 0) {
             vcs_candidates.push_back({local, aur_pkg});
@@ -1345,57 +1823,120 @@ void App::do_aur_upgrade() {
         fprintf(dbg, "checking %zu VCS package(s)...\n", vcs_candidates.size());
         fflush(dbg);
 
-        std::string vcs_log_file = "/tmp/pmt_vcs_check.log";
-        { FILE* f = fopen(vcs_log_file.c_str(), "w"); if (f) fclose(f); }
-
-        FILE* vcs_log_fp = fopen(vcs_log_file.c_str(), "r");
-        auto vcs_start_time = std::chrono::steady_clock::now();
-        std::vector<std::string> vcs_log_lines;
-        vcs_log_lines.push_back("Checking " + std::to_string(vcs_candidates.size()) + " VCS package(s)...");
-
-        auto vcs_tail_log = [&]() {
-            if (!vcs_log_fp) return;
-            clearerr(vcs_log_fp);
-            char buf[4096];
-            while (fgets(buf, sizeof(buf), vcs_log_fp)) {
-                std::string line(buf);
-                if (!line.empty() && line.back() == '\n') line.pop_back();
-                vcs_log_lines.push_back(std::move(line));
-            }
+        /* split packages share one clone, so each pkgbase is checked once */
+        struct VcsJob {
+            std::string base;
+            std::vector<size_t> members;
+            JobLog log;
+            std::atomic<int> state{JobLine::Queued};
+            std::string real_version;
         };
 
+        std::vector<std::string> bases;
+        std::unordered_map<std::string, size_t> base_slot;
+        std::vector<size_t> candidate_slot(vcs_candidates.size());
+        for (size_t vi = 0; vi < vcs_candidates.size(); vi++) {
+            const auto& [local, aur_pkg] = vcs_candidates[vi];
+            std::string base = aur_pkg.pkgbase.empty() ? local.name : aur_pkg.pkgbase;
+            auto [it, inserted] = base_slot.emplace(base, bases.size());
+            if (inserted) bases.push_back(base);
+            candidate_slot[vi] = it->second;
+        }
+
+        std::error_code ec;
+        std::string vcs_log_dir = "/tmp/pmt_vcs";
+        std::filesystem::create_directories(vcs_log_dir, ec);
+
+        std::vector<VcsJob> vcs_jobs(bases.size());
+        for (size_t ji = 0; ji < bases.size(); ji++) {
+            auto& job = vcs_jobs[ji];
+            job.base = bases[ji];
+            job.log.open(vcs_log_dir + "/" + job.base + ".log");
+        }
+        for (size_t vi = 0; vi < vcs_candidates.size(); vi++)
+            vcs_jobs[candidate_slot[vi]].members.push_back(vi);
+
+        size_t workers = job_workers(max_jobs, vcs_jobs.size());
+        fprintf(dbg, "checking %zu pkgbase(s) with %zu worker(s)\n", vcs_jobs.size(), workers);
+        fflush(dbg);
+
+        auto vcs_start_time = std::chrono::steady_clock::now();
         auto vcs_elapsed = [&]() -> int {
             return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(
                 std::chrono::steady_clock::now() - vcs_start_time).count());
         };
 
-        for (size_t vi = 0; vi < vcs_candidates.size(); vi++) {
-            const auto& [local, aur_pkg] = vcs_candidates[vi];
-            std::string vcs_title = "Checking VCS: " + local.name
-                + " [" + std::to_string(vi + 1) + "/" + std::to_string(vcs_candidates.size()) + "]";
+        std::atomic<bool> vcs_cancelled{false};
+        {
+            JobPool pool(workers);
+            for (auto& job : vcs_jobs) {
+                pool.submit([this, &job, &vcs_candidates, &vcs_cancelled]() {
+                    if (vcs_cancelled) {
+                        job.state = JobLine::Failed;
+                        return;
+                    }
+                    job.state = JobLine::Running;
+                    const auto& first = vcs_candidates[job.members[0]].first;
+                    job.real_version = aur_.check_vcs_version(first.name, job.base, job.log.sink());
+                    job.state = job.real_version.empty() ? JobLine::Failed : JobLine::Done;
+                });
+            }
 
-            vcs_log_lines.push_back("");
-            vcs_log_lines.push_back("=== Checking " + local.name + " ===");
+            std::string vcs_title = "Checking " + std::to_string(vcs_candidates.size())
+                + " VCS package(s) [" + std::to_string(workers) + " jobs]";
+            std::vector<JobLine> job_lines(vcs_jobs.size());
+            int focused = 0;
+            bool focus_pinned = false;
 
-            std::atomic<bool> vcs_done{false};
-            std::string real_version;
-            std::string pkg_name = local.name;
-            std::string pkgbase = aur_pkg.pkgbase;
-            std::thread vcs_thread([&, pkg_name, pkgbase]() {
-                real_version = aur_.check_vcs_version(pkg_name, pkgbase, vcs_log_file);
-                vcs_done = true;
-            });
-
-            while (!vcs_done.load()) {
-                vcs_tail_log();
-                ui_.draw_build_log(vcs_title, vcs_log_lines, false, vcs_elapsed());
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            drain_input();
+            KeyEvent ev;
+            for (;;) {
+                bool all_done = true;
+                for (size_t ji = 0; ji < vcs_jobs.size(); ji++) {
+                    auto& job = vcs_jobs[ji];
+                    auto& line = job_lines[ji];
+                    line.name = job.base;
+                    line.state = static_cast<JobLine::State>(job.state.load());
+                    if (line.state == JobLine::Queued) {
+                        line.detail = "queued";
+                        all_done = false;
+                    } else if (line.state == JobLine::Running) {
+                        line.detail = job.log.last();
+                        all_done = false;
+                    } else if (line.state == JobLine::Failed) {
+                        line.detail = "skipped (check failed)";
+                    } else {
+                        const auto& local = vcs_candidates[job.members[0]].first;
+                        int cmp = alpm_pkg_vercmp(job.real_version.c_str(), local.version.c_str());
+                        line.detail = cmp > 0
+                            ? local.version + " -> " + job.real_version + " (UPDATE AVAILABLE)"
+                            : "up to date (" + job.real_version + ")";
+                    }
+                }
+
+                update_job_focus(job_lines, ev, focused, focus_pinned);
+                {
+                    std::lock_guard<std::mutex> lock(vcs_jobs[focused].log.mutex);
+                    ui_.draw_job_log(vcs_title, job_lines, focused, vcs_jobs[focused].log.lines,
+                                     all_done, vcs_elapsed());
+                }
+                if (all_done) break;
+
+                ev = input_.read_key_timeout(100);
+                if (ev.key == Key::CtrlC) {
+                    aur_.cancel_commands(true);
+                    vcs_cancelled = true;
+                }
             }
-            vcs_thread.join();
-            vcs_tail_log();
+            pool.wait();
+        }
+        aur_.cancel_commands(false);
+
+        for (size_t vi = 0; vi < vcs_candidates.size(); vi++) {
+            const auto& [local, aur_pkg] = vcs_candidates[vi];
+            const std::string& real_version = vcs_jobs[candidate_slot[vi]].real_version;
 
             if (real_version.empty()) {
-                vcs_log_lines.push_back(local.name + ": skipped (check failed)");
                 fprintf(dbg, "  vcs %s: check failed, skipping\n", local.name.c_str());
                 continue;
             }
@@ -1404,19 +1945,15 @@ void App::do_aur_upgrade() {
             fprintf(dbg, "  vcs %s: local=%s real=%s cmp=%d\n",
                     local.name.c_str(), local.version.c_str(), real_version.c_str(), cmp);
             if (cmp > 0) {
-                vcs_log_lines.push_back(local.name + ": " + local.version + " -> " + real_version + " (UPDATE AVAILABLE)");
                 PackageInfo real_aur = aur_pkg;
                 real_aur.version = real_version;
                 upgrades.push_back({local, real_aur});
-            } else {
-                vcs_log_lines.push_back(local.name + ": up to date (" + real_version + ")");
             }
         }
 
-        if (vcs_log_fp) fclose(vcs_log_fp);
-
         terminal_.enter_raw_mode();
         terminal_.hide_cursor();
+        terminal_.invalidate();
     }
 
     fflush(dbg);
@@ -1455,6 +1992,7 @@ void App::do_aur_upgrade() {
 
     DepResolver resolver(aur_, alpm_);
     std::vector<PackageInfo> merged_build_order;
+    BuildGraph merged_build_deps;
     std::vector<std::string> merged_repo_deps;
     std::set<std::string> seen_bases;
 
@@ -1476,6 +2014,8 @@ void App::do_aur_upgrade() {
                 merged_build_order.push_back(std::move(p));
             }
         }
+        for (auto& [base, deps] : dep_result.build_deps)
+            merged_build_deps[base].insert(deps.begin(), deps.end());
 
         merged_repo_deps.insert(merged_repo_deps.end(),
                                 dep_result.repo_deps.begin(),
@@ -1493,7 +2033,7 @@ void App::do_aur_upgrade() {
         return;
     }
 
-    bool ok = run_aur_builds(merged_build_order, merged_repo_deps,
+    bool ok = run_aur_builds(merged_build_order, merged_build_deps, merged_repo_deps,
                              std::to_string(upgrades.size()) + " AUR packages");
 
     ui_.progress.active = false;
@@ -1510,39 +2050,18 @@ void App::do_aur_upgrade() {
 }
 
 void App::apply_sort() {
-    bool desc = ui_.sort_descending;
-    std::sort(packages_.begin(), packages_.end(),
-              [&](const PackageInfo& a, const PackageInfo& b) {
-        bool result;
-        switch (ui_.sort_mode) {
-            case SortMode::Name:
-                result = a.name < b.name; break;
-            case SortMode::InstallSize:
-                result = a.install_size > b.install_size; break;
-            case SortMode::Date:
-                result = a.build_date > b.build_date; break;
-            case SortMode::Votes:
-                result = a.aur_votes > b.aur_votes; break;
-            default:
-                result = a.name < b.name; break;
-        }
-        return desc ? !result : result;
-    });
+    packages_.sort(ui_.sort_mode, ui_.sort_descending);
 }
 
 void App::refresh_packages() {
-    packages_ = alpm_.list_installed();
+    packages_ = PackageList(alpm_.list_installed());
     apply_sort();
-    repo_results_.clear();
-    aur_results_.clear();
+    repo_results_.reset();
+    aur_results_.reset();
 }
 
 void App::update_display_list() {
-    if (ui_.show_aur) {
-        packages_ = aur_results_;
-    } else {
-        packages_ = repo_results_;
-    }
+    packages_ = PackageList(ui_.show_aur ? aur_results_ : repo_results_);
     apply_sort();
     ui_.selected = 0;
     ui_.list_scroll = 0;
@@ -5,12 +5,16 @@
 #include "alpm_wrapper.h"
 #include "aur.h"
 #include "dep_resolver.h"
+#include "job_pool.h"
+#include "wakeup.h"
+#include "package_cache.h"
 #include <string>
 #include <vector>
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <csignal>
 
 namespace pmt {
 
@@ -21,6 +25,9 @@ public:
 
     bool color_disabled = false;
     std::string accent_hex;
+    int max_jobs = 0;
+    bool timing = false;
+    std::string trace_path;
 
     bool init();
     void run();
@@ -32,9 +39,21 @@ private:
     AlpmWrapper alpm_;
     AurClient aur_;
 
-    std::vector<PackageInfo> packages_;
-    std::vector<PackageInfo> repo_results_;
-    std::vector<PackageInfo> aur_results_;
+    PackageList packages_;
+    ResultSetPtr repo_results_;
+    ResultSetPtr aur_results_;
+    PackageCache build_cache_;
+
+    std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+    std::mutex timing_mutex_;
+    struct Phase {
+        std::string name;
+        double start_ms;
+        double duration_ms;
+    };
+    std::vector<Phase> phases_;
+    void record_phase(const std::string& name, std::chrono::steady_clock::time_point begin);
+    void print_timing();
 
     bool running_ = true;
     bool needs_redraw_ = true;
@@ -44,20 +63,34 @@ private:
     static constexpr int DEBOUNCE_MS = 150;
     static constexpr int STATUS_TIMEOUT_MS = 3000;
 
-    std::thread search_thread_;
-    std::thread aur_search_thread_;
+    Wakeup wakeup_;
+    JobPool search_pool_{1};
+    JobPool aur_search_pool_{2};
     std::mutex search_mutex_;
-    std::vector<PackageInfo> search_results_buf_;
-    std::vector<PackageInfo> aur_results_buf_;
+    std::vector<PackageRow> search_results_buf_;
+    std::vector<PackageRow> aur_results_buf_;
+    std::vector<PackageRow> installed_buf_;
+    std::atomic<bool> installed_ready_{false};
     std::atomic<bool> search_ready_{false};
     std::atomic<bool> aur_ready_{false};
     std::atomic<uint64_t> search_gen_{0};
     std::atomic<uint64_t> aur_search_gen_{0};
     uint64_t current_search_gen_ = 0;
     uint64_t current_aur_gen_ = 0;
+    std::atomic<uint64_t> search_wanted_gen_{0};
+    std::atomic<uint64_t> aur_wanted_gen_{0};
+    bool aur_stream_done_ = false;
+    int aur_snapshots_ = 0;
+    static constexpr int AUR_PUBLISH_MS = 100;
+    void load_installed_async();
     void start_search(const std::string& query);
     void start_aur_search(const std::string& query);
+    void begin_aur_stream();
+    void run_aur_search(const std::string& query, uint64_t gen);
+    std::vector<PackageRow> search_aur_rows(const std::string& query);
     void poll_search_results();
+    void cancel_searches();
+    int next_deadline_ms();
 
     void handle_key(const KeyEvent& ev);
     void handle_search_key(const KeyEvent& ev);
@@ -76,6 +109,7 @@ private:
     void do_clear_cache();
 
     bool run_aur_builds(const std::vector<PackageInfo>& build_order,
+                        const BuildGraph& build_deps,
                         const std::vector<std::string>& repo_deps,
                         const std::string& summary_name);
 
@@ -86,7 +120,8 @@ private:
     void drain_input();
 
     static void sigwinch_handler(int sig);
-    static volatile bool resize_pending_;
+    static volatile sig_atomic_t resize_pending_;
+    static Wakeup* resize_wakeup_;
 };
 
 }
@@ -1,33 +1,301 @@
 #include "aur.h"
+#include "perf.h"
 #include <sys/socket.h>
-#include <sys/wait.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
+#include <poll.h>
 #include <unistd.h>
+#include <ctime>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <thread>
 
 namespace pmt {
 
 static constexpr const char* AUR_HOST = "aur.archlinux.org";
 
+namespace {
+
+/* maps /rpc/v5 result objects straight onto PackageInfo as parse events arrive */
+class AurResultsHandler : public JsonHandler {
+public:
+    explicit AurResultsHandler(const AurClient::ResultSink& sink) : sink_(sink) {}
+
+    const std::string& error() const { return error_; }
+
+    bool begin_object() override {
+        if (++depth_ == 3 && in_results_) {
+            cur_ = PackageInfo{};
+            cur_.source = PackageSource::AUR;
+            cur_.repo = "aur";
+            field_ = None;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        bool keep = true;
+        if (depth_ == 3 && in_results_) keep = sink_(std::move(cur_));
+        --depth_;
+        return keep;
+    }
+
+    bool begin_array() override {
+        ++depth_;
+        if (depth_ == 2 && root_key_ == "results") in_results_ = true;
+        if (depth_ == 4 && in_results_) list_ = list_field();
+        return true;
+    }
+
+    bool end_array() override {
+        if (depth_ == 2) in_results_ = false;
+        if (depth_ == 4) list_ = nullptr;
+        --depth_;
+        return true;
+    }
+
+    bool on_key(std::string_view key) override {
+        if (depth_ == 1) root_key_.assign(key);
+        else if (depth_ == 3 && in_results_) field_ = field_for(key);
+        return true;
+    }
+
+    bool on_string(std::string_view s) override {
+        if (depth_ == 1 && root_key_ == "error") {
+            error_.assign(s);
+        } else if (depth_ == 3 && in_results_) {
+            switch (field_) {
+                case Name:        cur_.name.assign(s); break;
+                case Version:     cur_.version.assign(s); break;
+                case Description: cur_.description.assign(s); break;
+                case Url:         cur_.url.assign(s); break;
+                case PackageBase: cur_.pkgbase.assign(s); break;
+                case Maintainer:  cur_.aur_maintainer.assign(s); break;
+                case OutOfDate:   cur_.aur_out_of_date = true; break;
+                default: break;
+            }
+        } else if (depth_ == 4 && list_) {
+            list_->emplace_back(s);
+        }
+        return true;
+    }
+
+    bool on_number(double v) override {
+        if (depth_ == 3 && in_results_) {
+            if (field_ == NumVotes) cur_.aur_votes = static_cast<int>(v);
+            else if (field_ == LastModified) cur_.aur_last_modified = static_cast<int64_t>(v);
+            else if (field_ == OutOfDate) cur_.aur_out_of_date = true;
+        }
+        return true;
+    }
+
+    bool on_bool(bool) override {
+        if (depth_ == 3 && in_results_ && field_ == OutOfDate) cur_.aur_out_of_date = true;
+        return true;
+    }
+
+private:
+    enum Field {
+        None, Name, Version, Description, Url, PackageBase, NumVotes, Maintainer, OutOfDate, LastModified,
+        Depends, OptDepends, Conflicts, Provides, MakeDepends, License,
+    };
+
+    const AurClient::ResultSink& sink_;
+    int depth_ = 0;
+    bool in_results_ = false;
+    std::string root_key_;
+    std::string error_;
+    PackageInfo cur_;
+    Field field_ = None;
+    std::vector<std::string>* list_ = nullptr;
+
+    static Field field_for(std::string_view key) {
+        static const std::pair<std::string_view, Field> table[] = {
+            {"Name", Name}, {"Version", Version}, {"Description", Description},
+            {"URL", Url}, {"PackageBase", PackageBase}, {"NumVotes", NumVotes},
+            {"Maintainer", Maintainer}, {"OutOfDate", OutOfDate}, {"LastModified", LastModified},
+            {"Depends", Depends}, {"OptDepends", OptDepends}, {"Conflicts", Conflicts},
+            {"Provides", Provides}, {"MakeDepends", MakeDepends}, {"License", License},
+        };
+        for (const auto& [name, field] : table)
+            if (name == key) return field;
+        return None;
+    }
+
+    std::vector<std::string>* list_field() {
+        switch (field_) {
+            case Depends:     return &cur_.depends;
+            case OptDepends:  return &cur_.optdepends;
+            case Conflicts:   return &cur_.conflicts;
+            case Provides:    return &cur_.provides;
+            case MakeDepends: return &cur_.makedepends;
+            case License:     return &cur_.licenses;
+            default:          return nullptr;
+        }
+    }
+};
+
+}
+
 AurClient::AurClient() {
     SSL_library_init();
     SSL_load_error_strings();
     ctx_ = SSL_CTX_new(TLS_client_method());
+    cache_.set_path(default_cache_dir() + "/.rpc_cache");
+    session_path_ = default_cache_dir() + "/.tls_session";
+
+    if (ctx_) {
+        SSL_CTX_set_app_data(ctx_, this);
+        SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx_, on_new_session);
+        load_session();
+    }
 }
 
 AurClient::~AurClient() {
-    if (ssl_) { SSL_shutdown(ssl_); SSL_free(ssl_); }
-    if (sockfd_ >= 0) close(sockfd_);
+    {
+        std::lock_guard<std::mutex> lock(keepalive_mutex_);
+        keepalive_stop_ = true;
+    }
+    keepalive_cv_.notify_all();
+    if (keepalive_thread_.joinable()) keepalive_thread_.join();
+
+    cache_.save();
+    for (auto& c : idle_) disconnect(*c);
+    save_session();
+    for (SSL_SESSION* s : sessions_) SSL_SESSION_free(s);
     if (ctx_) SSL_CTX_free(ctx_);
 }
 
-/* establishes persistent TLS connection to aur.archlinux.org */
-bool AurClient::ensure_connected() {
-    if (ssl_) return true;
+/* queues every ticket the server hands out, newest last; returning 1 takes ownership of it */
+int AurClient::on_new_session(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<AurClient*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    if (!self) return 0;
+    std::lock_guard<std::mutex> lock(self->session_mutex_);
+    self->sessions_.push_back(session);
+    if (self->sessions_.size() > MAX_SESSIONS) {
+        SSL_SESSION_free(self->sessions_.front());
+        self->sessions_.pop_front();
+    }
+    return 1;
+}
+
+/* a ticket for the next handshake, owned by the caller. TLS 1.3 tickets are single-use
+   (RFC 8446 C.4), so parallel connections each take their own; a TLS 1.2 session may
+   be resumed repeatedly and stays queued */
+SSL_SESSION* AurClient::take_session() {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    while (!sessions_.empty()) {
+        SSL_SESSION* s = sessions_.back();
+        long expires = SSL_SESSION_get_time(s) + SSL_SESSION_get_timeout(s);
+        if (!SSL_SESSION_is_resumable(s) || expires <= time(nullptr)) {
+            SSL_SESSION_free(s);
+            sessions_.pop_back();
+            continue;
+        }
+        if (SSL_SESSION_get_protocol_version(s) >= TLS1_3_VERSION) {
+            sessions_.pop_back();
+        } else {
+            SSL_SESSION_up_ref(s);
+        }
+        return s;
+    }
+    return nullptr;
+}
+
+/* resumes the previous run's TLS session so the first handshake is abbreviated */
+void AurClient::load_session() {
+    std::ifstream in(session_path_, std::ios::binary);
+    if (!in) return;
+    std::string der((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(der.data());
+    SSL_SESSION* session = d2i_SSL_SESSION(nullptr, &p, static_cast<long>(der.size()));
+    if (!session) return;
+
+    long expires = SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+    if (!SSL_SESSION_is_resumable(session) || expires <= time(nullptr)) {
+        SSL_SESSION_free(session);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    sessions_.push_back(session);
+}
+
+/* the ticket carries resumption secrets, so the file is private to its owner;
+   the newest unused one is kept for the next run */
+void AurClient::save_session() {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    if (sessions_.empty() || !SSL_SESSION_is_resumable(sessions_.back())) return;
+    SSL_SESSION* session = sessions_.back();
+
+    int len = i2d_SSL_SESSION(session, nullptr);
+    if (len <= 0) return;
+    std::string der(static_cast<size_t>(len), '\0');
+    unsigned char* p = reinterpret_cast<unsigned char*>(der.data());
+    i2d_SSL_SESSION(session, &p);
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(session_path_).parent_path(), ec);
+    std::string tmp = session_path_ + ".tmp." + std::to_string(getpid());
+    mode_t old_mask = umask(077);
+    FILE* f = fopen(tmp.c_str(), "wb");
+    umask(old_mask);
+    if (!f) return;
+    bool ok = fwrite(der.data(), 1, der.size(), f) == der.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), session_path_.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return;
+    }
+    chown_to_sudo_user(session_path_, false);
+}
+
+std::string AurClient::last_error() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return last_error_;
+}
+
+void AurClient::clear_metadata_cache() {
+    cache_.clear();
+    search_cache_.clear();
+}
+
+void AurClient::set_error(const std::string& msg) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_ = msg;
+}
+
+/* hands out an idle connection, opening a new slot while under MAX_CONNECTIONS */
+std::unique_ptr<AurClient::Connection> AurClient::acquire() {
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    pool_cv_.wait(lock, [this] { return !idle_.empty() || open_connections_ < MAX_CONNECTIONS; });
+    if (!idle_.empty()) {
+        auto c = std::move(idle_.back());
+        idle_.pop_back();
+        if (c->ssl && peer_closed(*c)) disconnect(*c);
+        return c;
+    }
+    ++open_connections_;
+    return std::make_unique<Connection>();
+}
+
+void AurClient::release(std::unique_ptr<Connection> c) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        idle_.push_back(std::move(c));
+    }
+    pool_cv_.notify_one();
+}
+
+/* establishes a persistent TLS connection to aur.archlinux.org */
+bool AurClient::ensure_connected(Connection& c) {
+    if (c.ssl) return true;
 
     struct addrinfo hints{}, *res = nullptr;
     hints.ai_family = AF_UNSPEC;
@@ -35,169 +303,436 @@ bool AurClient::ensure_connected() {
 
     int gai_ret = getaddrinfo(AUR_HOST, "443", &hints, &res);
     if (gai_ret != 0) {
-        last_error_ = "DNS resolution failed: " + std::string(gai_strerror(gai_ret));
+        c.error = "DNS resolution failed: " + std::string(gai_strerror(gai_ret));
         return false;
     }
 
-    sockfd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-    if (sockfd_ < 0) {
-        last_error_ = "Socket creation failed";
+    c.sockfd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (c.sockfd < 0) {
+        c.error = "Socket creation failed";
         freeaddrinfo(res);
         return false;
     }
 
-    if (connect(sockfd_, res->ai_addr, res->ai_addrlen) < 0) {
-        last_error_ = "Connection failed";
-        close(sockfd_); sockfd_ = -1;
+    int one = 1;
+    setsockopt(c.sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef TCP_FASTOPEN_CONNECT
+    /* the ClientHello rides on the SYN once the kernel holds a cookie for the host */
+    setsockopt(c.sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &one, sizeof(one));
+#endif
+
+    if (connect(c.sockfd, res->ai_addr, res->ai_addrlen) < 0) {
+        c.error = "Connection failed";
+        close(c.sockfd); c.sockfd = -1;
         freeaddrinfo(res);
         return false;
     }
     freeaddrinfo(res);
 
     if (!ctx_) {
-        ctx_ = SSL_CTX_new(TLS_client_method());
-        if (!ctx_) {
-            last_error_ = "SSL context creation failed";
-            close(sockfd_); sockfd_ = -1;
-            return false;
-        }
+        c.error = "SSL context creation failed";
+        close(c.sockfd); c.sockfd = -1;
+        return false;
     }
 
-    ssl_ = SSL_new(ctx_);
-    SSL_set_fd(ssl_, sockfd_);
-    SSL_set_tlsext_host_name(ssl_, AUR_HOST);
+    c.ssl = SSL_new(ctx_);
+    SSL_set_fd(c.ssl, c.sockfd);
+    SSL_set_tlsext_host_name(c.ssl, AUR_HOST);
+    if (SSL_SESSION* session = take_session()) {
+        SSL_set_session(c.ssl, session);
+        SSL_SESSION_free(session);
+    }
 
-    if (SSL_connect(ssl_) <= 0) {
-        last_error_ = "SSL handshake failed";
-        SSL_free(ssl_); ssl_ = nullptr;
-        close(sockfd_); sockfd_ = -1;
+    if (SSL_connect(c.ssl) <= 0) {
+        c.error = "SSL handshake failed";
+        SSL_free(c.ssl); c.ssl = nullptr;
+        close(c.sockfd); c.sockfd = -1;
         return false;
     }
 
-    reset_rbuf();
+    reset_rbuf(c);
+    c.close_after = false;
     return true;
 }
 
-void AurClient::disconnect() {
-    if (ssl_) { SSL_shutdown(ssl_); SSL_free(ssl_); ssl_ = nullptr; }
-    if (sockfd_ >= 0) { close(sockfd_); sockfd_ = -1; }
-    reset_rbuf();
+void AurClient::disconnect(Connection& c) {
+    if (c.ssl) { SSL_shutdown(c.ssl); SSL_free(c.ssl); c.ssl = nullptr; }
+    if (c.sockfd >= 0) { close(c.sockfd); c.sockfd = -1; }
+    reset_rbuf(c);
+}
+
+/* the server may have dropped an idle keep-alive connection while it sat in the pool */
+bool AurClient::peer_closed(const Connection& c) {
+    struct pollfd pfd{};
+    pfd.fd = c.sockfd;
+    pfd.events = POLLIN | POLLRDHUP;
+    if (poll(&pfd, 1, 0) <= 0) return false;
+    return pfd.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL);
 }
 
+/* makes sure one live connection is waiting in the pool; dead idle ones are dropped
+   first, and nothing is opened while every slot is busy with a request */
 void AurClient::preconnect() {
-    std::lock_guard<std::mutex> lock(conn_mutex_);
-    ensure_connected();
+    std::unique_ptr<Connection> c;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        bool live = false;
+        for (auto& idle : idle_) {
+            if (idle->ssl && peer_closed(*idle)) disconnect(*idle);
+            if (idle->ssl) live = true;
+        }
+        if (live) return;
+        if (!idle_.empty()) {
+            c = std::move(idle_.back());
+            idle_.pop_back();
+        } else if (open_connections_ < MAX_CONNECTIONS) {
+            ++open_connections_;
+            c = std::make_unique<Connection>();
+        } else {
+            return;
+        }
+    }
+    ensure_connected(*c);
+    release(std::move(c));
+}
+
+/* while the AUR tab is active a background thread keeps a warm connection ready,
+   reconnecting (with session resumption) whenever the server idles one out */
+void AurClient::set_keepalive(bool active) {
+    {
+        std::lock_guard<std::mutex> lock(keepalive_mutex_);
+        if (active == keepalive_active_) return;
+        keepalive_active_ = active;
+        keepalive_kick_ = active;
+        if (active && !keepalive_thread_.joinable())
+            keepalive_thread_ = std::thread([this]() { keepalive_loop(); });
+    }
+    keepalive_cv_.notify_all();
 }
 
-void AurClient::reset_rbuf() {
-    rbuf_len_ = 0;
-    rbuf_pos_ = 0;
+void AurClient::keepalive_loop() {
+    std::unique_lock<std::mutex> lock(keepalive_mutex_);
+    while (!keepalive_stop_) {
+        if (keepalive_active_) {
+            lock.unlock();
+            preconnect();
+            lock.lock();
+        }
+        keepalive_cv_.wait_for(lock, std::chrono::milliseconds(KEEPALIVE_INTERVAL_MS),
+                               [this]() { return keepalive_stop_ || keepalive_kick_; });
+        keepalive_kick_ = false;
+    }
+}
+
+void AurClient::reset_rbuf(Connection& c) {
+    c.rbuf_len = 0;
+    c.rbuf_pos = 0;
+}
+
+bool AurClient::fill_rbuf(Connection& c) {
+    if (c.rbuf_pos < c.rbuf_len) return true;
+    c.rbuf_len = SSL_read(c.ssl, c.rbuf, RBUF_SIZE);
+    c.rbuf_pos = 0;
+    if (c.rbuf_len <= 0) { c.rbuf_len = 0; return false; }
+    return true;
+}
+
+/* copies buffered bytes first, then reads the remainder straight into dst */
+size_t AurClient::read_exact(Connection& c, char* dst, size_t n) {
+    size_t got = 0;
+    if (c.rbuf_pos < c.rbuf_len) {
+        size_t avail = static_cast<size_t>(c.rbuf_len - c.rbuf_pos);
+        size_t take = avail < n ? avail : n;
+        memcpy(dst, c.rbuf + c.rbuf_pos, take);
+        c.rbuf_pos += static_cast<int>(take);
+        got = take;
+    }
+    while (got < n) {
+        size_t want = n - got;
+        int r = SSL_read(c.ssl, dst + got, want > INT32_MAX ? INT32_MAX : static_cast<int>(want));
+        if (r <= 0) break;
+        got += static_cast<size_t>(r);
+    }
+    return got;
 }
 
-int AurClient::ssl_read_byte() {
-    if (rbuf_pos_ >= rbuf_len_) {
-        rbuf_len_ = SSL_read(ssl_, rbuf_, RBUF_SIZE);
-        rbuf_pos_ = 0;
-        if (rbuf_len_ <= 0) return -1;
+bool AurClient::read_line(Connection& c, std::string& line) {
+    line.clear();
+    for (;;) {
+        if (!fill_rbuf(c)) return false;
+        const char* p = c.rbuf + c.rbuf_pos;
+        size_t avail = static_cast<size_t>(c.rbuf_len - c.rbuf_pos);
+        const char* nl = static_cast<const char*>(memchr(p, '\n', avail));
+        size_t take = nl ? static_cast<size_t>(nl - p) : avail;
+        line.append(p, take);
+        c.rbuf_pos += static_cast<int>(nl ? take + 1 : take);
+        if (nl) break;
     }
-    return static_cast<unsigned char>(rbuf_[rbuf_pos_++]);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
 }
 
-/* reads HTTP response with content-length and chunked encoding support */
-std::string AurClient::read_http_response() {
+bool AurClient::read_http_headers(Connection& c, long& content_length, bool& chunked) {
     std::string headers;
-    headers.reserve(512);
+    headers.reserve(1024);
     for (;;) {
-        int b = ssl_read_byte();
-        if (b < 0) { last_error_ = "Connection closed during headers"; return ""; }
-        headers += static_cast<char>(b);
-        size_t len = headers.size();
-        if (len >= 4 &&
-            headers[len-4] == '\r' && headers[len-3] == '\n' &&
-            headers[len-2] == '\r' && headers[len-1] == '\n') {
-            headers.resize(len - 4);
+        if (!fill_rbuf(c)) { c.error = "Connection closed during headers"; return false; }
+        size_t scan_from = headers.size() >= 3 ? headers.size() - 3 : 0;
+        headers.append(c.rbuf + c.rbuf_pos, c.rbuf_len - c.rbuf_pos);
+        c.rbuf_pos = c.rbuf_len;
+
+        const void* term = memmem(headers.data() + scan_from, headers.size() - scan_from,
+                                  "\r\n\r\n", 4);
+        if (term) {
+            size_t hdr_end = static_cast<const char*>(term) - headers.data();
+            size_t excess = headers.size() - (hdr_end + 4);
+            c.rbuf_pos = c.rbuf_len - static_cast<int>(excess);
+            headers.resize(hdr_end);
             break;
         }
     }
 
-    int content_length = -1;
-    bool chunked = false;
+    content_length = -1;
+    chunked = false;
+
+    /* a 429 or 503 page isn't JSON; report the status rather than a parse error */
+    size_t sp = headers.find(' ');
+    int status = headers.compare(0, 5, "HTTP/") == 0 && sp != std::string::npos
+                     ? atoi(headers.c_str() + sp + 1) : 0;
+    if (status < 200 || status >= 300) {
+        size_t eol = headers.find("\r\n");
+        c.error = status ? "HTTP error: " + headers.substr(sp + 1, eol == std::string::npos ? eol : eol - sp - 1)
+                         : "Malformed HTTP response";
+        c.close_after = true;
+        return false;
+    }
 
     std::string hdrs_lower = headers;
-    for (auto& c : hdrs_lower) c = static_cast<char>(tolower(c));
+    for (auto& ch : hdrs_lower) ch = static_cast<char>(tolower(ch));
 
     size_t cl_pos = hdrs_lower.find("content-length:");
     if (cl_pos != std::string::npos) {
-        content_length = atoi(headers.c_str() + cl_pos + 15);
+        content_length = atol(headers.c_str() + cl_pos + 15);
     }
     if (hdrs_lower.find("transfer-encoding: chunked") != std::string::npos) {
         chunked = true;
     }
+    c.close_after = hdrs_lower.find("connection: close") != std::string::npos;
+    return true;
+}
+
+/* reads HTTP response with content-length and chunked encoding support; bodies
+   over MAX_BODY_SIZE are refused before anything is allocated for them */
+std::string AurClient::read_http_response(Connection& c) {
+    long content_length = -1;
+    bool chunked = false;
+    if (!read_http_headers(c, content_length, chunked)) return "";
 
     std::string body;
-    if (content_length >= 0) {
-        body.reserve(content_length);
-        for (int i = 0; i < content_length; ++i) {
-            int b = ssl_read_byte();
-            if (b < 0) break;
-            body += static_cast<char>(b);
-        }
+    if (content_length > static_cast<long>(MAX_BODY_SIZE)) {
+        c.error = "Response too large";
+        c.close_after = true;
+    } else if (content_length >= 0) {
+        body.resize(static_cast<size_t>(content_length));
+        body.resize(read_exact(c, body.data(), body.size()));
     } else if (chunked) {
+        std::string size_line;
         for (;;) {
-            std::string size_line;
-            bool ok = true;
-            for (;;) {
-                int b = ssl_read_byte();
-                if (b < 0) { ok = false; break; }
-                if (b == '\n') break;
-                if (b != '\r') size_line += static_cast<char>(b);
-            }
-            if (!ok) break;
+            if (!read_line(c, size_line)) break;
             long chunk_size = strtol(size_line.c_str(), nullptr, 16);
-            if (chunk_size <= 0) break;
+            if (chunk_size <= 0) {
+                read_line(c, size_line);
+                break;
+            }
+            if (static_cast<size_t>(chunk_size) > MAX_BODY_SIZE - body.size()) {
+                c.error = "Response too large";
+                c.close_after = true;
+                body.clear();
+                break;
+            }
 
-            for (long i = 0; i < chunk_size; ++i) {
-                int b = ssl_read_byte();
-                if (b < 0) { ok = false; break; }
-                body += static_cast<char>(b);
+            size_t old = body.size();
+            body.resize(old + static_cast<size_t>(chunk_size));
+            size_t got = read_exact(c, body.data() + old, static_cast<size_t>(chunk_size));
+            if (got < static_cast<size_t>(chunk_size)) {
+                body.resize(old + got);
+                break;
             }
-            if (!ok) break;
-            ssl_read_byte();
-            ssl_read_byte();
+            if (!read_line(c, size_line)) break;
         }
     }
 
     return body;
 }
 
+/* hands body bytes to sink as records arrive; false if the body was cut short or the sink stopped */
+bool AurClient::stream_http_response(Connection& c, const BodySink& sink, size_t& delivered) {
+    delivered = 0;
+    long content_length = -1;
+    bool chunked = false;
+    if (!read_http_headers(c, content_length, chunked)) return false;
+
+    auto pass = [&](size_t n) -> bool {
+        while (n > 0) {
+            if (!fill_rbuf(c)) return false;
+            size_t avail = static_cast<size_t>(c.rbuf_len - c.rbuf_pos);
+            size_t take = avail < n ? avail : n;
+            const char* p = c.rbuf + c.rbuf_pos;
+            c.rbuf_pos += static_cast<int>(take);
+            n -= take;
+            delivered += take;
+            if (!sink(p, take)) return false;
+        }
+        return true;
+    };
+
+    if (content_length >= 0) return pass(static_cast<size_t>(content_length));
+    if (!chunked) return false;
+
+    std::string size_line;
+    for (;;) {
+        if (!read_line(c, size_line)) return false;
+        long chunk_size = strtol(size_line.c_str(), nullptr, 16);
+        if (chunk_size <= 0) {
+            read_line(c, size_line);
+            return true;
+        }
+        if (!pass(static_cast<size_t>(chunk_size))) return false;
+        if (!read_line(c, size_line)) return false;
+    }
+}
+
+static std::string make_request(const std::string& path) {
+    return "GET " + path + " HTTP/1.1\r\n"
+           "Host: " + AUR_HOST + "\r\n"
+           "Connection: keep-alive\r\n"
+           "User-Agent: pmt/1.0\r\n"
+           "\r\n";
+}
+
+/* writes all requests at once and reads the replies in order; returns how many arrived */
+size_t AurClient::get_pipelined(Connection& c, const std::string* paths, size_t count,
+                                std::string* bodies) {
+    std::string requests;
+    for (size_t i = 0; i < count; ++i)
+        requests += make_request(paths[i]);
+
+    reset_rbuf(c);
+    int written = SSL_write(c.ssl, requests.data(), static_cast<int>(requests.size()));
+    if (written <= 0) {
+        c.error = "Failed to send request";
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        bodies[i] = read_http_response(c);
+        if (bodies[i].empty()) return i;
+        if (c.close_after) {
+            disconnect(c);
+            return i + 1;
+        }
+    }
+    return count;
+}
+
+/* fetches every path, spreading them over the pool and pipelining on each connection;
+   bodies come back in path order, empty where a request failed */
+std::vector<std::string> AurClient::https_get_many(const std::vector<std::string>& paths) {
+    std::vector<std::string> bodies(paths.size());
+    if (paths.empty()) return bodies;
+    perf::Scope timer(perf::HttpsGet);
+
+    size_t workers = std::min(paths.size(), static_cast<size_t>(MAX_CONNECTIONS));
+
+    auto run = [&](size_t w) {
+        std::vector<size_t> mine;
+        for (size_t i = w; i < paths.size(); i += workers) mine.push_back(i);
+
+        std::vector<std::string> batch_paths, batch_bodies;
+        auto c = acquire();
+        c->error.clear();
+        size_t pos = 0;
+        int failures = 0;
+        while (pos < mine.size() && failures < 2) {
+            if (!ensure_connected(*c)) { ++failures; continue; }
+
+            size_t n = std::min(MAX_PIPELINE, mine.size() - pos);
+            batch_paths.clear();
+            for (size_t k = 0; k < n; ++k) batch_paths.push_back(paths[mine[pos + k]]);
+            batch_bodies.assign(n, std::string());
+
+            size_t got = get_pipelined(*c, batch_paths.data(), n, batch_bodies.data());
+            for (size_t k = 0; k < got; ++k) bodies[mine[pos + k]] = std::move(batch_bodies[k]);
+            pos += got;
+
+            if (got < n) {
+                disconnect(*c);
+                if (got == 0) ++failures;
+            } else {
+                failures = 0;
+            }
+        }
+        if (pos < mine.size())
+            set_error(c->error.empty() ? "HTTPS request failed" : c->error);
+        release(std::move(c));
+    };
+
+    if (workers == 1) {
+        run(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t w = 1; w < workers; ++w) threads.emplace_back(run, w);
+        run(0);
+        for (auto& t : threads) t.join();
+    }
+    if (perf::enabled())
+        for (const auto& b : bodies) timer.add(b.size());
+    return bodies;
+}
+
 /* HTTPS GET with keep-alive and auto-reconnect on failure */
 std::string AurClient::https_get(const std::string& path) {
-    std::lock_guard<std::mutex> lock(conn_mutex_);
+    return https_get_many({path})[0];
+}
 
-    for (int attempt = 0; attempt < 2; ++attempt) {
-        if (!ensure_connected()) return "";
+/* streaming GET; retries on a fresh connection only if nothing reached the sink yet */
+bool AurClient::https_get(const std::string& path, const BodySink& sink) {
+    perf::Scope timer(perf::HttpsGet);
+    auto c = acquire();
+    c->error.clear();
+    bool ok = false;
 
-        std::string request = "GET " + path + " HTTP/1.1\r\n"
-                              "Host: " + AUR_HOST + "\r\n"
-                              "Connection: keep-alive\r\n"
-                              "User-Agent: pmt/1.0\r\n"
-                              "\r\n";
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!ensure_connected(*c)) break;
 
-        int written = SSL_write(ssl_, request.c_str(), static_cast<int>(request.size()));
+        std::string request = make_request(path);
+        int written = SSL_write(c->ssl, request.c_str(), static_cast<int>(request.size()));
         if (written <= 0) {
-            disconnect();
+            disconnect(*c);
             continue;
         }
 
-        reset_rbuf();
-        std::string body = read_http_response();
-        if (!body.empty()) return body;
+        reset_rbuf(*c);
+        size_t delivered = 0;
+        bool streamed = stream_http_response(*c, sink, delivered);
+        timer.add(delivered);
+        if (streamed) {
+            ok = true;
+            if (c->close_after) disconnect(*c);
+            break;
+        }
 
-        disconnect();
+        /* the rest of an abandoned body is still on the wire */
+        disconnect(*c);
+        if (delivered > 0) {
+            if (c->error.empty()) c->error = "Connection closed during response";
+            break;
+        }
     }
 
-    if (last_error_.empty()) last_error_ = "HTTPS request failed";
-    return "";
+    if (!ok) set_error(c->error.empty() ? "HTTPS request failed" : c->error);
+    release(std::move(c));
+    return ok;
 }
 
 std::string AurClient::url_encode(const std::string& s) {
@@ -215,104 +750,234 @@ std::string AurClient::url_encode(const std::string& s) {
 }
 
 std::vector<PackageInfo> AurClient::search(const std::string& query) {
+    if (auto cached = search_cache_.lookup(query)) return *cached;
+
     std::string path = "/rpc/v5/search/" + url_encode(query);
     std::string body = https_get(path);
     if (body.empty()) return {};
-    return parse_results(body);
+    bool ok = false;
+    auto results = parse_results(body, &ok);
+    for (const auto& p : results)
+        cache_.revalidate(p.name, p.aur_last_modified);
+    if (ok) search_cache_.put(query, results);
+    return results;
+}
+
+/* results come from the query cache when it can answer; otherwise they are streamed
+   from the RPC and kept for the cache only once the reply turned out complete */
+bool AurClient::search_stream(const std::string& query, const ResultSink& on_result) {
+    if (auto cached = search_cache_.lookup(query)) {
+        for (const auto& p : *cached) {
+            PackageInfo copy = p;
+            if (!on_result(std::move(copy))) return false;
+        }
+        return true;
+    }
+
+    std::vector<PackageInfo> collected;
+    ResultSink revalidating = [&](PackageInfo&& p) {
+        cache_.revalidate(p.name, p.aur_last_modified);
+        collected.push_back(p);
+        return on_result(std::move(p));
+    };
+    AurResultsHandler handler(revalidating);
+    JsonStreamParser parser(handler);
+    std::string path = "/rpc/v5/search/" + url_encode(query);
+
+    bool ok = https_get(path, [&](const char* data, size_t len) {
+        return parser.feed(data, len);
+    });
+    if (parser.stopped()) return false;
+    if (!ok) {
+        if (!parser.error().empty()) set_error("Failed to parse AUR response: " + parser.error());
+        return false;
+    }
+    if (!parser.finish()) {
+        set_error("Failed to parse AUR response: " + parser.error());
+        return false;
+    }
+    if (!handler.error().empty()) {
+        set_error(handler.error());
+        return false;
+    }
+    search_cache_.put(query, std::move(collected));
+    return true;
 }
 
 PackageInfo AurClient::info(const std::string& name) {
+    PackageInfo cached;
+    if (cache_.get_info(name, cached)) return cached;
+
     std::string path = "/rpc/v5/info?arg[]=" + url_encode(name);
     std::string body = https_get(path);
     if (body.empty()) return {};
     auto results = parse_results(body);
     if (results.empty()) return {};
+    cache_.put_info(results[0]);
     return results[0];
 }
 
 std::vector<PackageInfo> AurClient::search_provides(const std::string& name) {
-    std::string path = "/rpc/v5/search/" + url_encode(name) + "?by=provides";
-    std::string body = https_get(path);
-    if (body.empty()) return {};
-    return parse_results(body);
+    return search_provides_batch({name})[0];
 }
 
-std::vector<PackageInfo> AurClient::info_batch(const std::vector<std::string>& names) {
+/* splits names into info URLs (at least one per pool connection) and fetches them concurrently */
+/* fresh skips cached entries for version checks, where a 30-minute-old reply would hide
+   a new release; the replies still refresh the cache for the resolver that follows */
+std::vector<PackageInfo> AurClient::info_batch(const std::vector<std::string>& names, bool fresh) {
     if (names.empty()) return {};
 
     std::vector<PackageInfo> all_results;
+    std::vector<std::string> misses;
+    for (const auto& n : names) {
+        PackageInfo cached;
+        if (!fresh && cache_.get_info(n, cached)) all_results.push_back(std::move(cached));
+        else misses.push_back(n);
+    }
+    if (misses.empty()) return all_results;
+
     static constexpr size_t MAX_URL_LEN = 4000;
+    static constexpr size_t MIN_URL_LEN = 512;
     static const std::string base_path = "/rpc/v5/info?";
 
-    size_t i = 0;
-    while (i < names.size()) {
-        std::string path = base_path;
-        bool first = true;
-        size_t batch_start = i;
-
-        while (i < names.size()) {
-            std::string param = (first ? "" : "&");
-            param += "arg[]=" + url_encode(names[i]);
-            if (path.size() + param.size() > MAX_URL_LEN && !first)
-                break;
-            path += param;
-            first = false;
-            ++i;
+    std::vector<std::string> params;
+    params.reserve(misses.size());
+    size_t total = 0;
+    for (const auto& n : misses) {
+        params.push_back("arg[]=" + url_encode(n));
+        total += params.back().size() + 1;
+    }
+    size_t target = std::clamp(total / MAX_CONNECTIONS + 1, MIN_URL_LEN, MAX_URL_LEN);
+
+    std::vector<std::string> paths;
+    std::string path = base_path;
+    for (const auto& param : params) {
+        if (path.size() > base_path.size() &&
+            path.size() + param.size() + 1 > target) {
+            paths.push_back(std::move(path));
+            path = base_path;
         }
+        if (path.size() > base_path.size()) path += '&';
+        path += param;
+    }
+    paths.push_back(std::move(path));
 
-        if (i == batch_start) break;
-
-        std::string body = https_get(path);
+    for (const auto& body : https_get_many(paths)) {
         if (body.empty()) continue;
         auto results = parse_results(body);
-        for (auto& pkg : results)
+        for (auto& pkg : results) {
+            cache_.put_info(pkg);
             all_results.push_back(std::move(pkg));
+        }
     }
-
     return all_results;
 }
 
-void AurClient::log_msg(const std::string& log_file, const std::string& msg) {
-    if (log_file.empty()) return;
-    FILE* f = fopen(log_file.c_str(), "a");
-    if (f) {
-        fprintf(f, "%s\n", msg.c_str());
-        fclose(f);
+std::vector<std::vector<PackageInfo>> AurClient::search_provides_batch(const std::vector<std::string>& names) {
+    std::vector<std::vector<PackageInfo>> results(names.size());
+    std::vector<std::string> misses;
+    std::vector<size_t> miss_index;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!cache_.get_provides(names[i], results[i])) {
+            misses.push_back(names[i]);
+            miss_index.push_back(i);
+        }
     }
+    if (misses.empty()) return results;
+
+    auto fetched = fetch_provides(misses);
+    for (size_t k = 0; k < misses.size(); ++k)
+        results[miss_index[k]] = std::move(fetched[k]);
+    return results;
 }
 
-int AurClient::run_cmd(const std::string& cmd, const std::string& log_file) {
-    std::string full_cmd;
-    if (!log_file.empty()) {
-        full_cmd = cmd + " >> '" + log_file + "' 2>&1";
-    } else {
-        full_cmd = cmd + " 2>&1";
+/* only successful replies are cached, so a failed lookup is retried next time */
+std::vector<std::vector<PackageInfo>> AurClient::fetch_provides(const std::vector<std::string>& names) {
+    std::vector<std::string> paths;
+    paths.reserve(names.size());
+    for (const auto& n : names)
+        paths.push_back("/rpc/v5/search/" + url_encode(n) + "?by=provides");
+
+    auto bodies = https_get_many(paths);
+    std::vector<std::vector<PackageInfo>> results(names.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies[i].empty()) continue;
+        bool ok = false;
+        results[i] = parse_results(bodies[i], &ok);
+        if (ok) cache_.put_provides(names[i], results[i]);
     }
-    int ret = system(full_cmd.c_str());
-    if (ret == -1) return -1;
-    return WIFEXITED(ret) ? WEXITSTATUS(ret) : -1;
+    return results;
+}
+
+void AurClient::log_msg(const LineSink& log, const std::string& msg) {
+    if (log) log(msg);
+}
+
+/* runs argv with output streamed to log; cancel_commands() aborts it */
+ProcessResult AurClient::run_cmd(const std::vector<std::string>& argv, const LineSink& log,
+                                 ProcessOptions opts) {
+    if (!opts.cancel) opts.cancel = &cancel_;
+    return run_process(argv, log, opts);
+}
+
+/* makepkg refuses to run as root; under sudo it is dropped to $SUDO_USER instead */
+bool AurClient::makepkg_allowed() {
+    return geteuid() != 0 || !sudo_prefix().empty();
+}
+
+/* commands that must not run as root go through sudo -u $SUDO_USER */
+std::vector<std::string> AurClient::sudo_prefix() {
+    const char* sudo_user = getenv("SUDO_USER");
+    if (geteuid() == 0 && sudo_user && sudo_user[0])
+        return {"sudo", "-H", "-u", sudo_user};
+    return {};
+}
+
+static std::vector<std::string> with_prefix(const std::vector<std::string>& prefix,
+                                            std::initializer_list<std::string> args) {
+    std::vector<std::string> argv = prefix;
+    argv.insert(argv.end(), args.begin(), args.end());
+    return argv;
+}
+
+/* resets and fast-forwards an existing clone of base, re-cloning when that fails */
+bool AurClient::sync_checkout(const std::string& base, const std::string& pkg_dir,
+                              const std::vector<std::string>& as_user, const LineSink& log) {
+    namespace fs = std::filesystem;
+
+    if (fs::exists(pkg_dir + "/.git")) {
+        log_msg(log, "Resetting local changes in " + base + "...");
+        run_cmd(with_prefix(as_user, {"git", "-C", pkg_dir, "checkout", "--", "."}), log);
+
+        log_msg(log, "Updating existing clone of " + base + "...");
+        if (!run_cmd(with_prefix(as_user, {"git", "-C", pkg_dir, "pull", "--ff-only"}), log).ok()) {
+            if (cancel_) return false;
+            log_msg(log, "Pull failed, re-cloning...");
+            fs::remove_all(pkg_dir);
+        }
+    }
+
+    if (!fs::exists(pkg_dir)) {
+        log_msg(log, "Cloning https://aur.archlinux.org/" + base + ".git ...");
+        auto argv = with_prefix(as_user, {"git", "clone", "--depth", "1",
+                                          "https://aur.archlinux.org/" + base + ".git", pkg_dir});
+        if (!run_cmd(argv, log).ok()) {
+            set_error("Failed to clone AUR package: " + base);
+            return false;
+        }
+    }
+    return true;
 }
 
 /* resolves real user home directory, handling SUDO_USER */
 std::string AurClient::resolve_home_dir() {
-    const char* home = nullptr;
     if (geteuid() == 0) {
         const char* sudo_user = getenv("SUDO_USER");
-        if (sudo_user && sudo_user[0]) {
-            std::string cmd = std::string("getent passwd '") + sudo_user + "' | cut -d: -f6";
-            FILE* fp = popen(cmd.c_str(), "r");
-            if (fp) {
-                static char buf[256];
-                if (fgets(buf, sizeof(buf), fp)) {
-                    size_t len = strlen(buf);
-                    if (len > 0 && buf[len-1] == '\n') buf[len-1] = '\0';
-                    home = buf;
-                }
-                pclose(fp);
-            }
-        }
+        UserInfo user;
+        if (sudo_user && sudo_user[0] && lookup_user(sudo_user, user) && !user.home.empty())
+            return user.home;
     }
-    if (!home || !home[0]) home = getenv("HOME");
+    const char* home = getenv("HOME");
     if (!home || !home[0]) return "/tmp";
     return std::string(home);
 }
@@ -369,55 +1034,32 @@ bool AurClient::is_vcs_package(const std::string& name) {
 /* runs makepkg --nobuild to determine real VCS package version */
 std::string AurClient::check_vcs_version(const std::string& name,
                                           const std::string& pkgbase,
-                                          const std::string& log_file) {
+                                          const LineSink& log) {
     namespace fs = std::filesystem;
 
     std::string base = (!pkgbase.empty() && pkgbase != name) ? pkgbase : name;
     std::string actual_dir = default_cache_dir();
     std::string pkg_dir = actual_dir + "/" + base;
-
-    const char* sudo_user = getenv("SUDO_USER");
-    std::string as_user;
-    if (geteuid() == 0 && sudo_user && sudo_user[0])
-        as_user = std::string("sudo -H -u ") + sudo_user + " ";
-
-    fs::create_directories(actual_dir);
-    if (!as_user.empty()) {
-        std::string cmd = "chown '" + std::string(sudo_user) + "' '" + actual_dir + "'";
-        system(cmd.c_str());
+    std::vector<std::string> as_user = sudo_prefix();
+    if (!makepkg_allowed()) {
+        set_error("Cannot run makepkg as root directly. Use: sudo ./pmt");
+        log_msg(log, "Running as root without SUDO_USER, skipping VCS check for " + base);
+        return "";
     }
 
-    if (fs::exists(pkg_dir + "/.git")) {
-        log_msg(log_file, "Resetting local changes in " + base + "...");
-        std::string reset_cmd = as_user + "git -C '" + pkg_dir + "' checkout -- .";
-        run_cmd(reset_cmd, log_file);
-
-        log_msg(log_file, "Updating existing clone of " + base + "...");
-        std::string cmd = as_user + "git -C '" + pkg_dir + "' pull --ff-only";
-        if (run_cmd(cmd, log_file) != 0) {
-            log_msg(log_file, "Pull failed, re-cloning...");
-            fs::remove_all(pkg_dir);
-        }
-    }
+    fs::create_directories(actual_dir);
+    chown_to_sudo_user(actual_dir, false);
 
-    if (!fs::exists(pkg_dir)) {
-        log_msg(log_file, "Cloning https://aur.archlinux.org/" + base + ".git ...");
-        std::string cmd = as_user + "git clone --depth 1 'https://aur.archlinux.org/"
-                          + base + ".git' '" + pkg_dir + "'";
-        if (run_cmd(cmd, log_file) != 0) {
-            log_msg(log_file, "Failed to clone " + base + ", skipping VCS check");
-            return "";
-        }
+    if (!sync_checkout(base, pkg_dir, as_user, log)) {
+        log_msg(log, "Failed to clone " + base + ", skipping VCS check");
+        return "";
     }
 
-    if (!as_user.empty() && fs::exists(pkg_dir)) {
-        std::string cmd = "chown -R '" + std::string(sudo_user) + "' '" + pkg_dir + "'";
-        system(cmd.c_str());
-    }
+    if (fs::exists(pkg_dir)) chown_to_sudo_user(pkg_dir);
 
     std::string pkgbuild_path = pkg_dir + "/PKGBUILD";
     if (!fs::exists(pkgbuild_path)) {
-        log_msg(log_file, "No PKGBUILD found for " + base);
+        log_msg(log, "No PKGBUILD found for " + base);
         return "";
     }
 
@@ -426,24 +1068,29 @@ std::string AurClient::check_vcs_version(const std::string& name,
         std::string content((std::istreambuf_iterator<char>(f)),
                              std::istreambuf_iterator<char>());
         if (content.find("pkgver()") == std::string::npos) {
-            log_msg(log_file, base + ": no pkgver() function, using static version");
+            log_msg(log, base + ": no pkgver() function, using static version");
             return parse_pkgbuild_version(pkgbuild_path);
         }
     }
 
-    log_msg(log_file, "Running makepkg --nobuild for " + base + " (fetching VCS sources)...");
-    std::string cmd = as_user + "bash -c 'cd \"" + pkg_dir
-                      + "\" && timeout 120 makepkg --nobuild --nocheck -f'";
-    int rc = run_cmd(cmd, log_file);
+    log_msg(log, "Running makepkg --nobuild for " + base + " (fetching VCS sources)...");
+    ProcessOptions opts;
+    opts.cwd = pkg_dir;
+    opts.timeout_ms = VCS_CHECK_TIMEOUT_MS;
+    auto res = run_cmd(with_prefix(as_user, {"makepkg", "--nobuild", "--nocheck", "-f"}), log, opts);
 
-    if (rc != 0 && rc != 13) {
-        log_msg(log_file, "makepkg --nobuild failed for " + base + " (exit " + std::to_string(rc) + "), skipping");
+    if (res.timed_out) {
+        log_msg(log, "makepkg --nobuild timed out for " + base + ", skipping");
+        return "";
+    }
+    if (res.status != 0 && res.status != 13) {
+        log_msg(log, "makepkg --nobuild failed for " + base + " (exit " + std::to_string(res.status) + "), skipping");
         return "";
     }
 
     std::string version = parse_pkgbuild_version(pkgbuild_path);
     if (!version.empty()) {
-        log_msg(log_file, base + ": real VCS version is " + version);
+        log_msg(log, base + ": real VCS version is " + version);
     }
     return version;
 }
@@ -456,44 +1103,50 @@ std::string AurClient::fetch_pkgbuild(const std::string& name, const std::string
     std::string actual_dir = default_cache_dir();
     std::string pkg_dir = actual_dir + "/" + base;
 
-    const char* sudo_user = getenv("SUDO_USER");
-    std::string as_user;
-    if (geteuid() == 0 && sudo_user && sudo_user[0])
-        as_user = std::string("sudo -H -u ") + sudo_user + " ";
-
     fs::create_directories(actual_dir);
-    if (!as_user.empty()) {
-        std::string cmd = "chown '" + std::string(sudo_user) + "' '" + actual_dir + "'";
-        system(cmd.c_str());
-    }
+    chown_to_sudo_user(actual_dir, false);
 
-    if (fs::exists(pkg_dir + "/.git")) {
-        std::string cmd = as_user + "git -C '" + pkg_dir + "' pull --ff-only >/dev/null 2>&1";
-        system(cmd.c_str());
-    } else {
-        std::string cmd = as_user + "git clone --depth 1 'https://aur.archlinux.org/"
-                          + base + ".git' '" + pkg_dir + "' >/dev/null 2>&1";
-        if (system(cmd.c_str()) != 0) {
-            last_error_ = "Failed to clone AUR package: " + base;
-            return "";
-        }
-    }
+    if (!sync_checkout(base, pkg_dir, sudo_prefix(), nullptr))
+        return "";
 
     std::string pkgbuild_path = pkg_dir + "/PKGBUILD";
+    std::error_code ec;
+    if (!fs::is_regular_file(fs::symlink_status(pkgbuild_path, ec))) {
+        set_error("PKGBUILD for " + base + " is missing or not a regular file");
+        return "";
+    }
     std::ifstream f(pkgbuild_path);
     if (!f) {
-        last_error_ = "PKGBUILD not found for: " + base;
+        set_error("PKGBUILD not found for: " + base);
         return "";
     }
     return std::string((std::istreambuf_iterator<char>(f)),
                         std::istreambuf_iterator<char>());
 }
 
+/* paths git tracks in a synced checkout; build products and fetched sources are left out */
+std::vector<std::string> AurClient::tracked_files(const std::string& name, const std::string& pkgbase) {
+    std::string base = (!pkgbase.empty() && pkgbase != name) ? pkgbase : name;
+    std::string pkg_dir = default_cache_dir() + "/" + base;
+
+    std::vector<std::string> files;
+    ProcessOptions opts;
+    opts.discard_stderr = true;
+    auto argv = with_prefix(sudo_prefix(), {"git", "-c", "core.quotepath=off", "-C", pkg_dir, "ls-files"});
+    auto res = run_cmd(argv, [&](const std::string& path) {
+        if (!path.empty()) files.push_back(path);
+    }, opts);
+    if (!res.ok()) files.clear();
+    return files;
+}
+
 /* clones AUR git repo and runs makepkg to produce .pkg.tar.zst */
 std::string AurClient::build_package(const std::string& name,
-                                     const std::string& log_file,
+                                     const LineSink& log,
                                      const std::string& build_dir,
-                                     const std::string& pkgbase) {
+                                     const std::string& pkgbase,
+                                     int make_jobs,
+                                     bool reuse_checkout) {
     namespace fs = std::filesystem;
 
     std::string base = (!pkgbase.empty() && pkgbase != name) ? pkgbase : name;
@@ -501,49 +1154,27 @@ std::string AurClient::build_package(const std::string& name,
     std::string actual_dir = build_dir.empty() ? default_cache_dir() : build_dir;
     std::string pkg_dir = actual_dir + "/" + base;
 
-    const char* sudo_user = getenv("SUDO_USER");
-    std::string as_user;
-    if (geteuid() == 0) {
-        if (sudo_user && sudo_user[0]) {
-            as_user = std::string("sudo -H -u ") + sudo_user + " ";
-        } else {
-            last_error_ = "Cannot build AUR packages as root directly. Use: sudo ./pmt";
-            return "";
-        }
+    std::vector<std::string> as_user = sudo_prefix();
+    if (!makepkg_allowed()) {
+        set_error("Cannot build AUR packages as root directly. Use: sudo ./pmt");
+        return "";
     }
 
-    log_msg(log_file, "Preparing build directory...");
+    log_msg(log, "Preparing build directory...");
     fs::create_directories(actual_dir);
-    if (!as_user.empty()) {
-        std::string cmd = "chown '" + std::string(sudo_user) + "' '" + actual_dir + "'";
-        system(cmd.c_str());
-        if (fs::exists(pkg_dir)) {
-            cmd = "chown -R '" + std::string(sudo_user) + "' '" + pkg_dir + "'";
-            system(cmd.c_str());
-        }
-    }
-
-    if (fs::exists(pkg_dir + "/.git")) {
-        log_msg(log_file, "Updating existing clone...");
-        std::string cmd = as_user + "git -C '" + pkg_dir + "' pull --ff-only";
-        if (run_cmd(cmd, log_file) != 0) {
-            log_msg(log_file, "Pull failed, re-cloning...");
-            fs::remove_all(pkg_dir);
-        }
-    }
-
-    if (!fs::exists(pkg_dir)) {
-        log_msg(log_file, "Cloning https://aur.archlinux.org/" + base + ".git ...");
-        std::string cmd = as_user + "git clone --depth 1 'https://aur.archlinux.org/"
-                          + base + ".git' '" + pkg_dir + "'";
-        if (run_cmd(cmd, log_file) != 0) {
-            last_error_ = "Failed to clone AUR package: " + base;
-            return "";
-        }
+    chown_to_sudo_user(actual_dir, false);
+    if (fs::exists(pkg_dir)) chown_to_sudo_user(pkg_dir);
+
+    /* the caller fetched and reviewed this checkout; pulling again could build
+       something other than what was reviewed */
+    if (reuse_checkout && fs::exists(pkg_dir + "/PKGBUILD")) {
+        log_msg(log, "Using reviewed checkout of " + base);
+    } else if (!sync_checkout(base, pkg_dir, as_user, log)) {
+        return "";
     }
 
     if (!fs::exists(pkg_dir + "/PKGBUILD")) {
-        last_error_ = "PKGBUILD not found for: " + name;
+        set_error("PKGBUILD not found for: " + name);
         return "";
     }
 
@@ -553,7 +1184,7 @@ std::string AurClient::build_package(const std::string& name,
             std::string fname = entry.path().filename().string();
             if (fname.find(".pkg.tar") != std::string::npos &&
                 fname.find(pkgbuild_ver) != std::string::npos) {
-                log_msg(log_file, "Using cached build: " + fname);
+                log_msg(log, "Using cached build: " + fname);
                 return entry.path().string();
             }
         }
@@ -565,17 +1196,20 @@ std::string AurClient::build_package(const std::string& name,
             fs::remove(entry.path());
     }
 
-    log_msg(log_file, "Running makepkg -sf --nocheck --noconfirm ...");
-    std::string cmd = as_user + "bash -c 'cd \"" + pkg_dir
-                      + "\" && MAKEFLAGS=-j$(nproc)"
-                        " PKGDEST=\"" + pkg_dir
-                      + "\" makepkg -sf --nocheck --noconfirm'";
-    if (run_cmd(cmd, log_file) != 0) {
-        last_error_ = "makepkg failed for: " + name;
+    log_msg(log, "Running makepkg -sf --nocheck --noconfirm ...");
+    if (make_jobs <= 0) make_jobs = std::max(1u, std::thread::hardware_concurrency());
+    ProcessOptions opts;
+    opts.cwd = pkg_dir;
+    /* sudo resets the environment, so the variables travel through env(1) */
+    auto argv = with_prefix(as_user, {"env", "MAKEFLAGS=-j" + std::to_string(make_jobs),
+                                      "PKGDEST=" + pkg_dir,
+                                      "makepkg", "-sf", "--nocheck", "--noconfirm"});
+    if (!run_cmd(argv, log, opts).ok()) {
+        set_error("makepkg failed for: " + name);
         return "";
     }
 
-    log_msg(log_file, "Locating built package...");
+    log_msg(log, "Locating built package...");
 
     for (const auto& entry : fs::directory_iterator(pkg_dir)) {
         std::string fname = entry.path().filename().string();
@@ -584,94 +1218,97 @@ std::string AurClient::build_package(const std::string& name,
         }
     }
 
-    std::string list_cmd = as_user + "bash -c 'cd \"" + pkg_dir
-                           + "\" && makepkg --packagelist 2>/dev/null'";
-    FILE* fp = popen(list_cmd.c_str(), "r");
-    if (fp) {
-        char buf[512];
-        while (fgets(buf, sizeof(buf), fp)) {
-            std::string path = buf;
-            while (!path.empty() && (path.back() == '\n' || path.back() == '\r'))
-                path.pop_back();
-            if (!path.empty() && fs::exists(path)) {
-                pclose(fp);
-                return path;
-            }
-        }
-        pclose(fp);
-    }
+    std::string listed;
+    ProcessOptions list_opts;
+    list_opts.cwd = pkg_dir;
+    list_opts.discard_stderr = true;
+    run_cmd(with_prefix(as_user, {"makepkg", "--packagelist"}), [&](const std::string& path) {
+        if (listed.empty() && !path.empty() && fs::exists(path)) listed = path;
+    }, list_opts);
+    if (!listed.empty()) return listed;
 
-    last_error_ = "Built package not found for: " + name;
+    set_error("Built package not found for: " + name);
     return "";
 }
 
-std::vector<PackageInfo> AurClient::parse_results(const std::string& json_str) {
+std::vector<PackageInfo> AurClient::parse_results(const std::string& json_str, bool* ok) {
+    perf::Scope timer(perf::ParseResults);
+    timer.add(json_str.size());
+    if (ok) *ok = false;
     JsonParser parser;
-    auto root = parser.parse(json_str);
+    auto root = parser.parse(json_str.data(), json_str.size());
     if (!root || !root->is_object()) {
-        last_error_ = "Failed to parse AUR response: " + parser.error();
+        set_error("Failed to parse AUR response: " + parser.error());
+        return {};
+    }
+
+    if ((*root)["type"]->view() == "error") {
+        set_error("AUR: " + (*root)["error"]->str());
         return {};
     }
 
     auto results = (*root)["results"];
     if (!results || !results->is_array()) return {};
+    if (ok) *ok = true;
 
     std::vector<PackageInfo> packages;
-    for (const auto& item : results->array_val) {
+    packages.reserve(results->size());
+    for (const auto& item : results->items()) {
         packages.push_back(json_to_package(item));
     }
     return packages;
 }
 
-PackageInfo AurClient::json_to_package(const JsonPtr& obj) {
+PackageInfo AurClient::json_to_package(const JsonValue& obj) {
     PackageInfo info;
     info.source = PackageSource::AUR;
     info.repo = "aur";
-    info.name = (*obj)["Name"]->str();
-    info.version = (*obj)["Version"]->str();
-    info.description = (*obj)["Description"]->str();
-    info.url = (*obj)["URL"]->str();
-    auto pkgbase = (*obj)["PackageBase"];
+    info.name = obj["Name"]->str();
+    info.version = obj["Version"]->str();
+    info.description = obj["Description"]->str();
+    info.url = obj["URL"]->str();
+    auto pkgbase = obj["PackageBase"];
     if (pkgbase && !pkgbase->is_null())
         info.pkgbase = pkgbase->str();
-    info.aur_votes = (*obj)["NumVotes"]->integer();
-    info.aur_maintainer = (*obj)["Maintainer"]->str();
-    info.aur_out_of_date = !(*obj)["OutOfDate"]->is_null();
+    info.aur_votes = obj["NumVotes"]->integer();
+    info.aur_maintainer = obj["Maintainer"]->str();
+    info.aur_out_of_date = !obj["OutOfDate"]->is_null();
+    info.aur_last_modified = static_cast<int64_t>(obj["LastModified"]->num());
 
-    auto deps = (*obj)["Depends"];
+    auto deps = obj["Depends"];
     if (deps && deps->is_array()) {
-        for (const auto& d : deps->array_val)
-            info.depends.push_back(d->str());
+        for (const auto& d : deps->items())
+            info.depends.emplace_back(d.view());
     }
 
-    auto optdeps = (*obj)["OptDepends"];
+    auto optdeps = obj["OptDepends"];
     if (optdeps && optdeps->is_array()) {
-        for (const auto& d : optdeps->array_val)
-            info.optdepends.push_back(d->str());
+        for (const auto& d : optdeps->items())
+            info.optdepends.emplace_back(d.view());
     }
 
-    auto conflicts = (*obj)["Conflicts"];
+    auto conflicts = obj["Conflicts"];
     if (conflicts && conflicts->is_array()) {
-        for (const auto& d : conflicts->array_val)
-            info.conflicts.push_back(d->str());
+        for (const auto& d : conflicts->items())
+            info.conflicts.emplace_back(d.view());
     }
 
-    auto provides = (*obj)["Provides"];
+    auto provides = obj["Provides"];
     if (provides && provides->is_array()) {
-        for (const auto& d : provides->array_val)
-            info.provides.push_back(d->str());
+        for (const auto& d : provides->items())
+            info.provides.emplace_back(d.view());
     }
 
-    auto makedeps = (*obj)["MakeDepends"];
+    auto makedeps = obj["MakeDepends"];
     if (makedeps && makedeps->is_array()) {
-        for (const auto& d : makedeps->array_val)
-            info.makedepends.push_back(d->str());
+        for (const auto& d : makedeps->items())
+            info.makedepends.emplace_back(d.view());
     }
 
-    auto licenses = (*obj)["License"];
+    auto licenses = obj["License"];
     if (licenses && licenses->is_array()) {
-        for (const auto& l : licenses->array_val)
-            info.licenses.push_back(l->str());
+        for (const auto& l : licenses->items())
+            info.licenses.emplace_back(l.view());
     }
 
     return info;
@@ -1,9 +1,18 @@
 #pragma once
 #include "package.h"
 #include "json.h"
+#include "aur_cache.h"
+#include "search_cache.h"
+#include "process.h"
 #include <string>
 #include <vector>
 #include <mutex>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include <openssl/ssl.h>
 
 namespace pmt {
@@ -16,46 +25,111 @@ public:
     AurClient(const AurClient&) = delete;
     AurClient& operator=(const AurClient&) = delete;
 
+    using ResultSink = std::function<bool(PackageInfo&&)>;
+    using BodySink = std::function<bool(const char*, size_t)>;
+
     std::vector<PackageInfo> search(const std::string& query);
+    bool search_stream(const std::string& query, const ResultSink& on_result);
     PackageInfo info(const std::string& name);
     std::vector<PackageInfo> search_provides(const std::string& name);
-    std::vector<PackageInfo> info_batch(const std::vector<std::string>& names);
+    std::vector<PackageInfo> info_batch(const std::vector<std::string>& names, bool fresh = false);
+    std::vector<std::vector<PackageInfo>> search_provides_batch(const std::vector<std::string>& names);
     void preconnect();
+    void set_keepalive(bool active);
     static bool is_vcs_package(const std::string& name);
+    static bool makepkg_allowed();
     std::string check_vcs_version(const std::string& name,
                                   const std::string& pkgbase = "",
-                                  const std::string& log_file = "");
+                                  const LineSink& log = nullptr);
     std::string build_package(const std::string& name,
-                              const std::string& log_file = "",
+                              const LineSink& log = nullptr,
                               const std::string& build_dir = "",
-                              const std::string& pkgbase = "");
+                              const std::string& pkgbase = "",
+                              int make_jobs = 0,
+                              bool reuse_checkout = false);
     std::string fetch_pkgbuild(const std::string& name, const std::string& pkgbase = "");
-    std::string last_error() const { return last_error_; }
+    std::vector<std::string> tracked_files(const std::string& name, const std::string& pkgbase = "");
+    std::string last_error() const;
+    void clear_metadata_cache();
+    void cancel_commands(bool cancel) { cancel_ = cancel; }
 
 private:
-    std::string last_error_;
+    friend struct AurBenchAccess;
+
+    static constexpr int RBUF_SIZE = 16384;
+    static constexpr int MAX_CONNECTIONS = 4;
+    static constexpr size_t MAX_PIPELINE = 8;
+    static constexpr int VCS_CHECK_TIMEOUT_MS = 120000;
+    static constexpr int KEEPALIVE_INTERVAL_MS = 20000;
+    static constexpr size_t MAX_SESSIONS = 8;
+    static constexpr size_t MAX_BODY_SIZE = 64u << 20;
+
+    struct Connection {
+        int sockfd = -1;
+        SSL* ssl = nullptr;
+        char rbuf[RBUF_SIZE];
+        int rbuf_len = 0;
+        int rbuf_pos = 0;
+        bool close_after = false;
+        std::string error;
+    };
 
-    std::mutex conn_mutex_;
-    int sockfd_ = -1;
+    mutable std::mutex error_mutex_;
+    std::string last_error_;
+    std::atomic<bool> cancel_{false};
     SSL_CTX* ctx_ = nullptr;
-    SSL* ssl_ = nullptr;
+    AurCache cache_;
+    SearchCache search_cache_;
+
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cv_;
+    std::vector<std::unique_ptr<Connection>> idle_;
+    int open_connections_ = 0;
+
+    std::mutex session_mutex_;
+    std::deque<SSL_SESSION*> sessions_;
+    std::string session_path_;
 
-    static constexpr int RBUF_SIZE = 8192;
-    char rbuf_[RBUF_SIZE]{};
-    int rbuf_len_ = 0;
-    int rbuf_pos_ = 0;
+    std::mutex keepalive_mutex_;
+    std::condition_variable keepalive_cv_;
+    std::thread keepalive_thread_;
+    bool keepalive_active_ = false;
+    bool keepalive_kick_ = false;
+    bool keepalive_stop_ = false;
 
-    bool ensure_connected();
-    void disconnect();
-    void reset_rbuf();
-    int ssl_read_byte();
+    void set_error(const std::string& msg);
+    static int on_new_session(SSL* ssl, SSL_SESSION* session);
+    void load_session();
+    void save_session();
+    SSL_SESSION* take_session();
+    static bool peer_closed(const Connection& c);
+    void keepalive_loop();
+    std::unique_ptr<Connection> acquire();
+    void release(std::unique_ptr<Connection> c);
+    bool ensure_connected(Connection& c);
+    static void disconnect(Connection& c);
+    static void reset_rbuf(Connection& c);
+    static bool fill_rbuf(Connection& c);
+    static size_t read_exact(Connection& c, char* dst, size_t n);
+    static bool read_line(Connection& c, std::string& line);
+    static bool read_http_headers(Connection& c, long& content_length, bool& chunked);
+    static std::string read_http_response(Connection& c);
+    static bool stream_http_response(Connection& c, const BodySink& sink, size_t& delivered);
+    static size_t get_pipelined(Connection& c, const std::string* paths, size_t count,
+                                std::string* bodies);
+    std::vector<std::string> https_get_many(const std::vector<std::string>& paths);
+    std::vector<std::vector<PackageInfo>> fetch_provides(const std::vector<std::string>& names);
     std::string https_get(const std::string& path);
-    std::string read_http_response();
-    std::vector<PackageInfo> parse_results(const std::string& json_str);
-    PackageInfo json_to_package(const JsonPtr& obj);
+    bool https_get(const std::string& path, const BodySink& sink);
+    std::vector<PackageInfo> parse_results(const std::string& json_str, bool* ok = nullptr);
+    PackageInfo json_to_package(const JsonValue& obj);
     static std::string url_encode(const std::string& s);
-    int run_cmd(const std::string& cmd, const std::string& log_file);
-    void log_msg(const std::string& log_file, const std::string& msg);
+    ProcessResult run_cmd(const std::vector<std::string>& argv, const LineSink& log,
+                          ProcessOptions opts = {});
+    static void log_msg(const LineSink& log, const std::string& msg);
+    static std::vector<std::string> sudo_prefix();
+    bool sync_checkout(const std::string& base, const std::string& pkg_dir,
+                       const std::vector<std::string>& as_user, const LineSink& log);
     static std::string parse_pkgbuild_version(const std::string& pkgbuild_path);
     static std::string resolve_home_dir();
 
@@ -0,0 +1,326 @@
+#include "aur_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <pwd.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace pmt {
+
+static constexpr char CACHE_MAGIC[8] = {'P', 'M', 'T', 'A', 'U', 'R', 'C', 1};
+static constexpr int64_t MAX_ENTRY_AGE = 7 * 24 * 60 * 60;
+
+namespace {
+
+class Writer {
+public:
+    std::string buf;
+
+    void u8(uint8_t v) { buf += static_cast<char>(v); }
+    void u32(uint32_t v) { buf.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void i64(int64_t v) { buf.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void str(const std::string& s) { u32(static_cast<uint32_t>(s.size())); buf += s; }
+    void strs(const std::vector<std::string>& v) {
+        u32(static_cast<uint32_t>(v.size()));
+        for (const auto& s : v) str(s);
+    }
+};
+
+class Reader {
+public:
+    Reader(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+    bool ok() const { return ok_; }
+    bool at_end() const { return p_ == end_; }
+
+    uint8_t u8() { uint8_t v = 0; raw(&v, sizeof(v)); return v; }
+    uint32_t u32() { uint32_t v = 0; raw(&v, sizeof(v)); return v; }
+    int64_t i64() { int64_t v = 0; raw(&v, sizeof(v)); return v; }
+
+    std::string str() {
+        uint32_t n = u32();
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) { ok_ = false; return {}; }
+        std::string s(p_, n);
+        p_ += n;
+        return s;
+    }
+
+    std::vector<std::string> strs() {
+        uint32_t n = u32();
+        std::vector<std::string> v;
+        if (!ok_ || n > static_cast<size_t>(end_ - p_) / sizeof(uint32_t)) { ok_ = false; return v; }
+        v.reserve(n);
+        for (uint32_t i = 0; i < n && ok_; ++i) v.push_back(str());
+        return v;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ok_ = true;
+
+    void raw(void* dst, size_t n) {
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) { ok_ = false; return; }
+        memcpy(dst, p_, n);
+        p_ += n;
+    }
+};
+
+void write_package(Writer& w, const PackageInfo& p) {
+    w.str(p.name);
+    w.str(p.version);
+    w.str(p.description);
+    w.str(p.url);
+    w.str(p.pkgbase);
+    w.str(p.aur_maintainer);
+    w.u32(static_cast<uint32_t>(p.aur_votes));
+    w.u8(p.aur_out_of_date ? 1 : 0);
+    w.i64(p.aur_last_modified);
+    w.strs(p.depends);
+    w.strs(p.makedepends);
+    w.strs(p.optdepends);
+    w.strs(p.conflicts);
+    w.strs(p.provides);
+    w.strs(p.licenses);
+}
+
+PackageInfo read_package(Reader& r) {
+    PackageInfo p;
+    p.source = PackageSource::AUR;
+    p.repo = "aur";
+    p.name = r.str();
+    p.version = r.str();
+    p.description = r.str();
+    p.url = r.str();
+    p.pkgbase = r.str();
+    p.aur_maintainer = r.str();
+    p.aur_votes = static_cast<int>(r.u32());
+    p.aur_out_of_date = r.u8() != 0;
+    p.aur_last_modified = r.i64();
+    p.depends = r.strs();
+    p.makedepends = r.strs();
+    p.optdepends = r.strs();
+    p.conflicts = r.strs();
+    p.provides = r.strs();
+    p.licenses = r.strs();
+    return p;
+}
+
+int64_t now_seconds() {
+    return static_cast<int64_t>(time(nullptr));
+}
+
+}
+
+void AurCache::set_path(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path == path_) return;
+    path_ = path;
+    loaded_ = false;
+}
+
+bool AurCache::load() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return load_locked();
+}
+
+void AurCache::ensure_loaded() {
+    if (!loaded_) load_locked();
+}
+
+/* a missing, truncated or foreign file simply starts an empty cache */
+bool AurCache::load_locked() {
+    loaded_ = true;
+    dirty_ = false;
+    info_.clear();
+    provides_.clear();
+    if (path_.empty()) return false;
+
+    FILE* f = fopen(path_.c_str(), "rb");
+    if (!f) return false;
+    std::string data;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.append(chunk, n);
+    fclose(f);
+
+    if (data.size() < sizeof(CACHE_MAGIC) ||
+        memcmp(data.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+        return false;
+
+    Reader r(data.data() + sizeof(CACHE_MAGIC), data.size() - sizeof(CACHE_MAGIC));
+    uint32_t info_count = r.u32();
+    for (uint32_t i = 0; i < info_count && r.ok(); ++i) {
+        InfoEntry e;
+        e.fetched_at = r.i64();
+        e.info = read_package(r);
+        if (r.ok()) {
+            std::string key = e.info.name;
+            info_[std::move(key)] = std::move(e);
+        }
+    }
+    uint32_t prov_count = r.u32();
+    for (uint32_t i = 0; i < prov_count && r.ok(); ++i) {
+        std::string dep = r.str();
+        ProvidesEntry e;
+        e.fetched_at = r.i64();
+        e.providers = r.strs();
+        if (r.ok()) provides_[std::move(dep)] = std::move(e);
+    }
+
+    if (!r.ok()) {
+        info_.clear();
+        provides_.clear();
+        return false;
+    }
+    return true;
+}
+
+/* writes to a temp file and renames it over the old cache so readers never see a partial file */
+bool AurCache::save() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_ || path_.empty()) return true;
+
+    int64_t now = now_seconds();
+    Writer w;
+    w.buf.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+    uint32_t info_count = 0;
+    for (const auto& [name, e] : info_)
+        if (now - e.fetched_at < MAX_ENTRY_AGE) ++info_count;
+    w.u32(info_count);
+    for (const auto& [name, e] : info_) {
+        if (now - e.fetched_at >= MAX_ENTRY_AGE) continue;
+        w.i64(e.fetched_at);
+        write_package(w, e.info);
+    }
+
+    uint32_t prov_count = 0;
+    for (const auto& [dep, e] : provides_)
+        if (now - e.fetched_at < MAX_ENTRY_AGE) ++prov_count;
+    w.u32(prov_count);
+    for (const auto& [dep, e] : provides_) {
+        if (now - e.fetched_at >= MAX_ENTRY_AGE) continue;
+        w.str(dep);
+        w.i64(e.fetched_at);
+        w.strs(e.providers);
+    }
+
+    std::error_code ec;
+    fs::path dir = fs::path(path_).parent_path();
+    fs::create_directories(dir, ec);
+
+    std::string tmp = path_ + ".tmp." + std::to_string(getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(w.buf.data(), 1, w.buf.size(), f) == w.buf.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    const char* sudo_user = getenv("SUDO_USER");
+    if (geteuid() == 0 && sudo_user && sudo_user[0]) {
+        if (struct passwd* pw = getpwnam(sudo_user)) {
+            if (chown(tmp.c_str(), pw->pw_uid, pw->pw_gid) != 0) {
+                /* still usable by root; the user just cannot refresh it */
+            }
+        }
+    }
+
+    if (rename(tmp.c_str(), path_.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+bool AurCache::get_info(const std::string& name, PackageInfo& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_loaded();
+    auto it = info_.find(name);
+    if (it == info_.end() || now_seconds() - it->second.fetched_at >= INFO_TTL) return false;
+    out = it->second.info;
+    return true;
+}
+
+/* a hit needs the provider list and every provider's info to still be fresh */
+bool AurCache::get_provides(const std::string& dep_name, std::vector<PackageInfo>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_loaded();
+    auto it = provides_.find(dep_name);
+    int64_t now = now_seconds();
+    if (it == provides_.end() || now - it->second.fetched_at >= PROVIDES_TTL) return false;
+
+    std::vector<PackageInfo> result;
+    result.reserve(it->second.providers.size());
+    for (const auto& name : it->second.providers) {
+        auto pit = info_.find(name);
+        if (pit == info_.end() || now - pit->second.fetched_at >= INFO_TTL) return false;
+        result.push_back(pit->second.info);
+    }
+    out = std::move(result);
+    return true;
+}
+
+void AurCache::put_info(const PackageInfo& info) {
+    if (info.name.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_loaded();
+    auto& e = info_[info.name];
+    e.info = info;
+    e.info.installed = false;
+    e.info.installed_version.clear();
+    e.info.has_update = false;
+    e.fetched_at = now_seconds();
+    dirty_ = true;
+}
+
+void AurCache::put_provides(const std::string& dep_name, const std::vector<PackageInfo>& providers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_loaded();
+    int64_t now = now_seconds();
+    auto& e = provides_[dep_name];
+    e.providers.clear();
+    for (const auto& p : providers) {
+        e.providers.push_back(p.name);
+        auto& ie = info_[p.name];
+        ie.info = p;
+        ie.fetched_at = now;
+    }
+    e.fetched_at = now;
+    dirty_ = true;
+}
+
+/* search results carry LastModified; an unchanged timestamp renews the entry, a new one drops it */
+void AurCache::revalidate(const std::string& name, int64_t last_modified) {
+    if (last_modified <= 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_loaded();
+    auto it = info_.find(name);
+    if (it == info_.end()) return;
+    if (it->second.info.aur_last_modified == last_modified) {
+        it->second.fetched_at = now_seconds();
+    } else {
+        info_.erase(it);
+    }
+    dirty_ = true;
+}
+
+void AurCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    info_.clear();
+    provides_.clear();
+    loaded_ = true;
+    dirty_ = false;
+    if (!path_.empty()) unlink(path_.c_str());
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "package.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace pmt {
+
+/* persistent cache of AUR RPC info and provides lookups in a compact binary file */
+class AurCache {
+public:
+    static constexpr int64_t INFO_TTL = 30 * 60;
+    static constexpr int64_t PROVIDES_TTL = 6 * 60 * 60;
+
+    explicit AurCache(std::string path = "") : path_(std::move(path)) {}
+
+    void set_path(const std::string& path);
+    bool load();
+    bool save();
+
+    bool get_info(const std::string& name, PackageInfo& out);
+    bool get_provides(const std::string& dep_name, std::vector<PackageInfo>& out);
+    void put_info(const PackageInfo& info);
+    void put_provides(const std::string& dep_name, const std::vector<PackageInfo>& providers);
+    void revalidate(const std::string& name, int64_t last_modified);
+    void clear();
+
+private:
+    struct InfoEntry {
+        PackageInfo info;
+        int64_t fetched_at = 0;
+    };
+
+    struct ProvidesEntry {
+        std::vector<std::string> providers;
+        int64_t fetched_at = 0;
+    };
+
+    std::mutex mutex_;
+    std::string path_;
+    bool loaded_ = false;
+    bool dirty_ = false;
+    std::unordered_map<std::string, InfoEntry> info_;
+    std::unordered_map<std::string, ProvidesEntry> provides_;
+
+    void ensure_loaded();
+    bool load_locked();
+};
+
+}
@@ -0,0 +1,346 @@
+#include "cli.h"
+#include "dep_resolver.h"
+#include "job_pool.h"
+#include "perf.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace pmt {
+
+namespace {
+
+/* stdout is shared by VCS check workers */
+std::mutex out_mutex;
+
+/* one NDJSON line, written and flushed as a unit so consumers see it immediately */
+class Record {
+public:
+    explicit Record(const char* type) {
+        out_ = "{\"type\":";
+        quote(type);
+    }
+
+    Record& str(const char* key, const std::string& value) {
+        this->key(key);
+        quote(value);
+        return *this;
+    }
+
+    Record& num(const char* key, int64_t value) {
+        this->key(key);
+        out_ += std::to_string(value);
+        return *this;
+    }
+
+    Record& flag(const char* key, bool value) {
+        this->key(key);
+        out_ += value ? "true" : "false";
+        return *this;
+    }
+
+    Record& list(const char* key, const std::vector<std::string>& values) {
+        this->key(key);
+        out_ += '[';
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i > 0) out_ += ',';
+            quote(values[i]);
+        }
+        out_ += ']';
+        return *this;
+    }
+
+    void emit() {
+        out_ += "}\n";
+        std::lock_guard<std::mutex> lock(out_mutex);
+        fwrite(out_.data(), 1, out_.size(), stdout);
+        fflush(stdout);
+    }
+
+private:
+    std::string out_;
+
+    void key(const char* k) {
+        out_ += ',';
+        quote(k);
+        out_ += ':';
+    }
+
+    void quote(const std::string& s) {
+        out_ += '"';
+        for (unsigned char c : s) {
+            switch (c) {
+                case '"':  out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\n': out_ += "\\n"; break;
+                case '\r': out_ += "\\r"; break;
+                case '\t': out_ += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        char buf[8];
+                        snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out_ += buf;
+                    } else {
+                        out_ += static_cast<char>(c);
+                    }
+            }
+        }
+        out_ += '"';
+    }
+};
+
+const char* source_name(PackageSource source) {
+    switch (source) {
+        case PackageSource::Sync:  return "repo";
+        case PackageSource::Local: return "local";
+        case PackageSource::AUR:   return "aur";
+    }
+    return "repo";
+}
+
+void emit_error(const std::string& msg) {
+    Record("error").str("message", msg).emit();
+}
+
+void emit_package(const PackageRow& row, const PackageInfo& info) {
+    Record r("package");
+    r.str("source", source_name(row.source))
+     .str("repo", row.repo)
+     .str("name", row.name)
+     .str("version", row.version)
+     .str("description", info.description)
+     .flag("installed", row.installed);
+    if (row.installed) r.str("installed_version", row.installed_version);
+    if (row.source == PackageSource::AUR)
+        r.num("votes", row.aur_votes).flag("out_of_date", row.aur_out_of_date);
+    r.emit();
+}
+
+void emit_update(const char* source, const PackageRow& local, const std::string& repo,
+                 const std::string& version, bool vcs) {
+    Record r("update");
+    r.str("source", source)
+     .str("repo", repo)
+     .str("name", local.name)
+     .str("installed_version", local.installed_version)
+     .str("version", version);
+    if (vcs) r.flag("vcs", true);
+    r.emit();
+}
+
+}
+
+/* any headless mode flag routes the whole invocation here instead of the TUI */
+bool Cli::requested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--json") == 0 || strcmp(argv[i], "--resolve") == 0) return true;
+    return false;
+}
+
+int Cli::usage_error(const std::string& msg) {
+    fprintf(stderr, "%s\n", msg.c_str());
+    fprintf(stderr, "Try 'pmt --help' for usage.\n");
+    return 1;
+}
+
+int Cli::run(int argc, char* argv[]) {
+    std::string command, argument;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0 || strcmp(argv[i], "--disable-color") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--accent") == 0 && i + 1 < argc) {
+            ++i;
+        } else if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+            max_jobs_ = atoi(argv[++i]);
+            if (max_jobs_ < 1) return usage_error("Invalid job count: " + std::string(argv[i]));
+        } else if (strcmp(argv[i], "--timing") == 0) {
+            timing_ = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path_ = argv[++i];
+        } else if (strcmp(argv[i], "--resolve") == 0 && i + 1 < argc && command.empty()) {
+            command = "resolve";
+            argument = argv[++i];
+        } else if (strcmp(argv[i], "search") == 0 && i + 1 < argc && command.empty()) {
+            command = "search";
+            argument = argv[++i];
+        } else if (strcmp(argv[i], "updates") == 0 && command.empty()) {
+            command = "updates";
+        } else {
+            return usage_error("Unknown option: " + std::string(argv[i]));
+        }
+    }
+    if (command.empty()) return usage_error("--json needs a command: search <query> or updates");
+
+    if (!trace_path_.empty() && !perf::start_trace(trace_path_)) {
+        emit_error("Cannot write trace file " + trace_path_);
+        return 1;
+    }
+
+    using ms = std::chrono::duration<double, std::milli>;
+    auto start = std::chrono::steady_clock::now();
+    bool ready = init();
+    auto ready_at = std::chrono::steady_clock::now();
+    int status = ready ? dispatch(command, argument) : 1;
+    auto end = std::chrono::steady_clock::now();
+    perf::stop_trace();
+
+    /* stderr, like the TUI's table, so stdout stays pure NDJSON */
+    if (timing_) {
+        fprintf(stderr, "%-20s %10s %10s\n", "phase", "start ms", "took ms");
+        fprintf(stderr, "%-20s %10.2f %10.2f\n", "init", 0.0, ms(ready_at - start).count());
+        if (ready)
+            fprintf(stderr, "%-20s %10.2f %10.2f\n", command.c_str(), ms(ready_at - start).count(),
+                    ms(end - ready_at).count());
+    }
+    return status;
+}
+
+int Cli::dispatch(const std::string& command, const std::string& argument) {
+    if (command == "search") return search(argument);
+    if (command == "updates") return updates();
+    return resolve(argument);
+}
+
+bool Cli::init() {
+    PacmanConfig config;
+    if (!config.parse()) {
+        emit_error("Failed to parse /etc/pacman.conf");
+        return false;
+    }
+    if (!alpm_.init(config)) {
+        emit_error(alpm_.last_error());
+        return false;
+    }
+    return true;
+}
+
+/* repo matches first since they need no network, then AUR rows as the reply streams in */
+int Cli::search(const std::string& query) {
+    for (const auto& row : alpm_.search(query)) {
+        if (row.details) emit_package(row, *row.details);
+        else emit_package(row, alpm_.package_details(row));
+    }
+
+    /* the AUR rejects queries shorter than two characters */
+    if (query.size() < 2) return 0;
+    bool ok = aur_.search_stream(query, [this](PackageInfo&& info) {
+        PackageRow row = make_row(std::move(info));
+        alpm_.mark_installed(row);
+        emit_package(row, *row.details);
+        return true;
+    });
+    if (!ok) {
+        emit_error("AUR search failed: " + aur_.last_error());
+        return 1;
+    }
+    return 0;
+}
+
+/* same checks as the TUI's upgrade flow: newer sync versions, newer AUR versions,
+   and VCS packages whose upstream moved past the installed build */
+int Cli::updates() {
+    std::vector<PackageRow> foreign, repo_updates;
+    alpm_.scan_local(&foreign, &repo_updates);
+    for (const auto& row : repo_updates)
+        emit_update("repo", row, row.repo, row.version, false);
+
+    if (foreign.empty()) return 0;
+
+    std::vector<std::string> names;
+    names.reserve(foreign.size());
+    for (const auto& pkg : foreign) names.push_back(pkg.name);
+    auto aur_info = aur_.info_batch(names, true);
+    if (aur_info.empty() && !aur_.last_error().empty()) {
+        emit_error("AUR query failed: " + aur_.last_error());
+        return 1;
+    }
+
+    std::unordered_map<std::string_view, const PackageInfo*> aur_map;
+    aur_map.reserve(aur_info.size());
+    for (const auto& p : aur_info) aur_map.emplace(p.name, &p);
+
+    /* split packages share one clone, so each pkgbase is checked once */
+    std::vector<std::string> bases;
+    std::unordered_map<std::string, std::vector<size_t>> base_members;
+    for (size_t i = 0; i < foreign.size(); ++i) {
+        auto it = aur_map.find(foreign[i].name);
+        if (it == aur_map.end()) continue;
+        const PackageInfo& aur_pkg = *it->second;
+        if (alpm_pkg_vercmp(aur_pkg.version.c_str(), foreign[i].version.c_str()) > 0) {
+            emit_update("aur", foreign[i], "aur", aur_pkg.version, false);
+            continue;
+        }
+        if (!AurClient::is_vcs_package(foreign[i].name)) continue;
+        std::string base = aur_pkg.pkgbase.empty() ? foreign[i].name : aur_pkg.pkgbase;
+        auto& members = base_members[base];
+        if (members.empty()) bases.push_back(base);
+        members.push_back(i);
+    }
+    if (bases.empty()) return 0;
+
+    /* root without SUDO_USER (cron, systemd) has no user to run makepkg as */
+    if (!AurClient::makepkg_allowed()) {
+        Record("error")
+            .str("message", "VCS checks need makepkg, which can't run as root; run via sudo or as a user")
+            .list("pkgbases", bases)
+            .emit();
+        return 1;
+    }
+
+    std::atomic<bool> failed{false};
+    size_t workers = max_jobs_ > 0 ? static_cast<size_t>(max_jobs_) : JobPool::default_workers();
+    JobPool pool(std::max<size_t>(1, std::min(workers, bases.size())));
+    for (const auto& base : bases) {
+        pool.submit([this, &base, &base_members, &foreign, &failed]() {
+            const auto& members = base_members.at(base);
+            std::string real_version = aur_.check_vcs_version(foreign[members[0]].name, base);
+            if (real_version.empty()) {
+                Record("error").str("message", "VCS check failed").str("pkgbase", base).emit();
+                failed = true;
+                return;
+            }
+            for (size_t i : members) {
+                if (alpm_pkg_vercmp(real_version.c_str(), foreign[i].version.c_str()) > 0)
+                    emit_update("aur", foreign[i], "aur", real_version, true);
+            }
+        });
+    }
+    pool.wait();
+    return failed ? 1 : 0;
+}
+
+/* repo deps, already satisfied deps, then AUR builds in install order with their in-set prerequisites */
+int Cli::resolve(const std::string& name) {
+    DepResolver resolver(aur_, alpm_);
+    DepResolution res = resolver.resolve(name, [](const std::string& msg) {
+        Record("log").str("message", msg).emit();
+    });
+    if (!res.ok) {
+        emit_error(res.error);
+        return 1;
+    }
+
+    for (const auto& dep : res.repo_deps)
+        Record("repo_dep").str("name", dep).emit();
+    for (const auto& dep : res.satisfied_deps)
+        Record("satisfied").str("name", dep).emit();
+    for (const auto& pkg : res.aur_build_order) {
+        std::string base = pkg.pkgbase.empty() ? pkg.name : pkg.pkgbase;
+        std::vector<std::string> after;
+        auto it = res.build_deps.find(base);
+        if (it != res.build_deps.end()) after.assign(it->second.begin(), it->second.end());
+        Record("build")
+            .str("name", pkg.name)
+            .str("pkgbase", base)
+            .str("version", pkg.version)
+            .list("after", after)
+            .emit();
+    }
+    return 0;
+}
+
+}
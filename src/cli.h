@@ -0,0 +1,30 @@
+#pragma once
+#include "alpm_wrapper.h"
+#include "aur.h"
+#include <string>
+
+namespace pmt {
+
+/* headless front end: drives the alpm, AUR and resolver engines directly and
+   streams one JSON object per line to stdout, without touching the terminal */
+class Cli {
+public:
+    static bool requested(int argc, char* argv[]);
+    int run(int argc, char* argv[]);
+
+private:
+    AlpmWrapper alpm_;
+    AurClient aur_;
+    int max_jobs_ = 0;
+    bool timing_ = false;
+    std::string trace_path_;
+
+    bool init();
+    int dispatch(const std::string& command, const std::string& argument);
+    int search(const std::string& query);
+    int updates();
+    int resolve(const std::string& name);
+    static int usage_error(const std::string& msg);
+};
+
+}
@@ -1,4 +1,5 @@
 #include "dep_resolver.h"
+#include "perf.h"
 
 namespace pmt {
 
@@ -7,9 +8,10 @@ DepResolver::DepResolver(AurClient& aur, AlpmWrapper& alpm)
 
 /* resolves full AUR dependency tree into topological build order */
 DepResolution DepResolver::resolve(const std::string& name, LogCallback log) {
+    perf::Scope timer(perf::Resolve);
     log_ = log;
-    visited_.clear();
-    in_stack_.clear();
+    edges_.clear();
+    skipped_.clear();
     build_order_.clear();
     repo_deps_.clear();
     satisfied_deps_.clear();
@@ -19,7 +21,8 @@ DepResolution DepResolver::resolve(const std::string& name, LogCallback log) {
 
     if (log_) log_("Resolving dependencies for " + name + "...");
 
-    bool ok = dfs(name);
+    bool ok = expand(name) && order(name);
+    auto build_deps = base_graph();
 
     std::set<std::string> seen_bases;
     std::vector<PackageInfo> deduped;
@@ -36,101 +39,170 @@ DepResolution DepResolver::resolve(const std::string& name, LogCallback log) {
     result.ok = ok;
     result.error = error_;
     result.aur_build_order = std::move(deduped);
+    result.build_deps = std::move(build_deps);
     result.repo_deps = std::move(repo_deps_);
     result.satisfied_deps = std::move(satisfied_deps_);
     return result;
 }
 
-/* recursive DFS: fetches AUR info, categorizes deps as repo/aur/satisfied */
-bool DepResolver::dfs(const std::string& name) {
-    if (visited_.count(name)) return true;
+/* collapses the name graph onto pkgbases: each base maps to the other bases in the
+   build set it needs installed first; split packages pool their edges */
+BuildGraph DepResolver::base_graph() const {
+    std::map<std::string, std::string> base_of;
+    for (const auto& p : build_order_)
+        base_of[p.name] = p.pkgbase.empty() ? p.name : p.pkgbase;
+
+    BuildGraph graph;
+    for (const auto& [name, base] : base_of) {
+        auto& deps = graph[base];
+        auto it = edges_.find(name);
+        if (it == edges_.end()) continue;
+        for (const auto& dep : it->second) {
+            auto dep_base = base_of.find(dep);
+            if (dep_base != base_of.end() && dep_base->second != base)
+                deps.insert(dep_base->second);
+        }
+    }
+    return graph;
+}
+
+/* fetches info for every name in the frontier at once */
+void DepResolver::fetch_level(const std::vector<std::string>& names) {
+    std::vector<std::string> need;
+    for (const auto& n : names) {
+        if (!aur_cache_.count(n) && !provides_map_.count(n)) need.push_back(n);
+    }
+    if (need.empty()) return;
 
-    if (in_stack_.count(name)) {
-        error_ = "Circular dependency detected: " + name;
+    if (log_) log_("Batch-fetching " + std::to_string(need.size()) + " AUR packages...");
+    auto batch = aur_.info_batch(need);
+    for (auto& p : batch) {
+        std::string key = p.name;
+        aur_cache_[key] = std::move(p);
+    }
+}
+
+/* walks the graph one level at a time: every unresolved name of a level goes out in one
+   info batch, and whatever that misses in one concurrent provides lookup */
+bool DepResolver::expand(const std::string& root) {
+    fetch_level({root});
+    if (!aur_cache_.count(root)) {
+        error_ = "Package not found in AUR: " + root;
         return false;
     }
 
-    in_stack_.insert(name);
+    std::set<std::string> queued = {root};
+    std::vector<std::string> frontier = {root};
 
-    if (log_) log_("Fetching AUR info for " + name + "...");
+    struct PendingDep {
+        std::string node;
+        std::string dep;
+        std::string dep_name;
+    };
 
-    PackageInfo pkg;
-    auto it = aur_cache_.find(name);
-    if (it != aur_cache_.end()) {
-        pkg = it->second;
-    } else {
-        pkg = aur_.info(name);
-        if (pkg.name.empty()) {
-            in_stack_.erase(name);
-            error_ = "Package not found in AUR: " + name;
-            return false;
-        }
-        aur_cache_[name] = pkg;
-    }
+    std::set<std::string> seen_repo, seen_satisfied;
 
-    if (alpm_.is_dep_satisfied(pkg.name + "=" + pkg.version)) {
-        if (log_) log_("Skipping " + name + " (" + pkg.version + " already installed)");
-        visited_.insert(name);
-        in_stack_.erase(name);
-        return true;
-    }
+    while (!frontier.empty()) {
+        std::vector<PendingDep> pending;
+        std::vector<std::string> unknown;
+        std::set<std::string> unknown_set;
 
-    std::vector<std::string> all_deps;
-    all_deps.insert(all_deps.end(), pkg.depends.begin(), pkg.depends.end());
-    all_deps.insert(all_deps.end(), pkg.makedepends.begin(), pkg.makedepends.end());
-
-    std::vector<std::string> unknown_names;
-    for (const auto& dep : all_deps) {
-        std::string dep_name = strip_version(dep);
-        if (visited_.count(dep_name) || in_stack_.count(dep_name)) continue;
-        if (alpm_.is_dep_satisfied(dep)) continue;
-        if (alpm_.is_dep_in_repos(dep)) continue;
-        if (aur_cache_.count(dep_name)) continue;
-        unknown_names.push_back(dep_name);
-    }
+        for (const auto& node : frontier) {
+            const PackageInfo& pkg = aur_cache_[node];
+            edges_[node];
+
+            if (alpm_.is_dep_satisfied(pkg.name + "=" + pkg.version)) {
+                if (log_) log_("Skipping " + node + " (" + pkg.version + " already installed)");
+                skipped_.insert(node);
+                continue;
+            }
 
-    if (!unknown_names.empty()) {
-        if (log_) log_("Batch-fetching " + std::to_string(unknown_names.size()) + " AUR dependencies...");
-        auto batch = aur_.info_batch(unknown_names);
-        for (auto& p : batch) {
-            aur_cache_[p.name] = std::move(p);
+            std::vector<std::string> all_deps;
+            all_deps.insert(all_deps.end(), pkg.depends.begin(), pkg.depends.end());
+            all_deps.insert(all_deps.end(), pkg.makedepends.begin(), pkg.makedepends.end());
+
+            for (const auto& dep : all_deps) {
+                if (alpm_.is_dep_satisfied(dep)) {
+                    if (seen_satisfied.insert(dep).second) satisfied_deps_.push_back(dep);
+                    continue;
+                }
+                if (alpm_.is_dep_in_repos(dep)) {
+                    if (seen_repo.insert(dep).second) repo_deps_.push_back(dep);
+                    continue;
+                }
+
+                std::string dep_name = strip_version(dep);
+                if (!aur_cache_.count(dep_name) && !provides_map_.count(dep_name) &&
+                    unknown_set.insert(dep_name).second)
+                    unknown.push_back(dep_name);
+                pending.push_back({node, dep, std::move(dep_name)});
+            }
         }
-    }
 
-    for (const auto& dep : all_deps) {
-        std::string dep_name = strip_version(dep);
+        if (!unknown.empty()) {
+            fetch_level(unknown);
 
-        if (alpm_.is_dep_satisfied(dep)) {
-            satisfied_deps_.push_back(dep);
-            continue;
+            std::vector<std::string> virtual_names;
+            for (const auto& n : unknown) {
+                if (!aur_cache_.count(n) && !provides_map_.count(n))
+                    virtual_names.push_back(n);
+            }
+            if (!virtual_names.empty()) prefetch_providers(virtual_names);
         }
 
-        if (alpm_.is_dep_in_repos(dep)) {
-            repo_deps_.push_back(dep);
-            continue;
-        }
+        std::vector<std::string> next;
+        for (const auto& pd : pending) {
+            std::string target;
+            auto it = aur_cache_.find(pd.dep_name);
+            if (it != aur_cache_.end() && !it->second.name.empty()) {
+                target = pd.dep_name;
+            } else {
+                target = find_provider(pd.dep_name);
+            }
 
-        if (aur_cache_.count(dep_name) && !aur_cache_[dep_name].name.empty()) {
-            if (!dfs(dep_name)) return false;
-            continue;
-        }
+            if (target.empty()) {
+                error_ = "Dependency not found anywhere: " + pd.dep + " (required by " + pd.node + ")";
+                return false;
+            }
 
-        std::string provider = find_provider(dep_name);
-        if (!provider.empty()) {
-            if (!dfs(provider)) return false;
-            continue;
+            edges_[pd.node].push_back(target);
+            if (queued.insert(target).second) next.push_back(target);
         }
 
-        error_ = "Dependency not found anywhere: " + dep + " (required by " + name + ")";
-        return false;
+        frontier = std::move(next);
     }
+    return true;
+}
 
-    visited_.insert(name);
-    in_stack_.erase(name);
-    build_order_.push_back(pkg);
+/* post-order walk of the finished graph; a back edge means a dependency cycle */
+bool DepResolver::order(const std::string& root) {
+    enum Mark { Unvisited, Active, Done };
+    std::map<std::string, Mark> marks;
 
-    if (log_) log_("Resolved: " + name);
-    return true;
+    std::function<bool(const std::string&)> visit = [&](const std::string& name) -> bool {
+        Mark& m = marks[name];
+        if (m == Done) return true;
+        if (m == Active) {
+            error_ = "Circular dependency detected: " + name;
+            return false;
+        }
+        m = Active;
+
+        if (!skipped_.count(name)) {
+            for (const auto& dep : edges_[name]) {
+                if (!visit(dep)) return false;
+            }
+        }
+
+        marks[name] = Done;
+        if (!skipped_.count(name)) {
+            build_order_.push_back(aur_cache_[name]);
+            if (log_) log_("Resolved: " + name);
+        }
+        return true;
+    };
+
+    return visit(root);
 }
 
 /* searches AUR for packages that provide a virtual dependency */
@@ -142,7 +214,19 @@ std::string DepResolver::find_provider(const std::string& dep_name) {
     if (log_) log_("Searching AUR for provider of " + dep_name + "...");
 
     auto providers = aur_.search_provides(dep_name);
+    return record_provider(dep_name, providers);
+}
+
+/* looks up providers for several virtual dependencies concurrently */
+void DepResolver::prefetch_providers(const std::vector<std::string>& dep_names) {
+    if (log_) log_("Searching AUR for providers of " + std::to_string(dep_names.size()) + " dependencies...");
+
+    auto results = aur_.search_provides_batch(dep_names);
+    for (size_t i = 0; i < dep_names.size(); ++i)
+        record_provider(dep_names[i], results[i]);
+}
 
+std::string DepResolver::record_provider(const std::string& dep_name, std::vector<PackageInfo>& providers) {
     for (auto& p : providers) {
         for (const auto& prov : p.provides) {
             std::string prov_name = strip_version(prov);
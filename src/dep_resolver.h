@@ -10,10 +10,14 @@
 
 namespace pmt {
 
+/* pkgbase -> pkgbases in the same build set that must be installed first */
+using BuildGraph = std::map<std::string, std::set<std::string>>;
+
 struct DepResolution {
     bool ok = false;
     std::string error;
     std::vector<PackageInfo> aur_build_order;
+    BuildGraph build_deps;
     std::vector<std::string> repo_deps;
     std::vector<std::string> satisfied_deps;
 };
@@ -31,8 +35,8 @@ private:
     AlpmWrapper& alpm_;
     LogCallback log_;
 
-    std::set<std::string> visited_;
-    std::set<std::string> in_stack_;
+    std::map<std::string, std::vector<std::string>> edges_;
+    std::set<std::string> skipped_;
     std::vector<PackageInfo> build_order_;
     std::vector<std::string> repo_deps_;
     std::vector<std::string> satisfied_deps_;
@@ -41,8 +45,13 @@ private:
     std::map<std::string, PackageInfo> aur_cache_;
     std::map<std::string, std::string> provides_map_;
 
-    bool dfs(const std::string& name);
+    bool expand(const std::string& root);
+    bool order(const std::string& root);
+    BuildGraph base_graph() const;
+    void fetch_level(const std::vector<std::string>& names);
     std::string find_provider(const std::string& dep_name);
+    void prefetch_providers(const std::vector<std::string>& dep_names);
+    std::string record_provider(const std::string& dep_name, std::vector<PackageInfo>& providers);
     static std::string strip_version(const std::string& depstring);
 };
 
@@ -0,0 +1,181 @@
+#include "diff.h"
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+namespace pmt {
+
+namespace {
+
+/* lines are interned to ints up front so the search compares integers, not strings */
+class MyersDiff {
+public:
+    MyersDiff(const std::vector<int>& a, const std::vector<int>& b)
+        : a_(a), b_(b), removed_(a.size(), 0), added_(b.size(), 0) {
+        size_t max_d = (a.size() + b.size() + 1) / 2;
+        forward_.resize(2 * max_d + 2);
+        reverse_.resize(2 * max_d + 2);
+    }
+
+    void run() { compare(0, static_cast<int>(a_.size()), 0, static_cast<int>(b_.size())); }
+
+    const std::vector<char>& removed() const { return removed_; }
+    const std::vector<char>& added() const { return added_; }
+
+private:
+    const std::vector<int>& a_;
+    const std::vector<int>& b_;
+    std::vector<char> removed_;
+    std::vector<char> added_;
+    std::vector<int> forward_;
+    std::vector<int> reverse_;
+
+    void compare(int a_lo, int a_hi, int b_lo, int b_hi) {
+        while (a_lo < a_hi && b_lo < b_hi && a_[a_lo] == b_[b_lo]) { ++a_lo; ++b_lo; }
+        while (a_lo < a_hi && b_lo < b_hi && a_[a_hi - 1] == b_[b_hi - 1]) { --a_hi; --b_hi; }
+
+        if (a_lo == a_hi) {
+            for (int j = b_lo; j < b_hi; ++j) added_[j] = 1;
+            return;
+        }
+        if (b_lo == b_hi) {
+            for (int i = a_lo; i < a_hi; ++i) removed_[i] = 1;
+            return;
+        }
+
+        int x, y;
+        if (!middle_snake(a_lo, a_hi, b_lo, b_hi, x, y)) {
+            for (int i = a_lo; i < a_hi; ++i) removed_[i] = 1;
+            for (int j = b_lo; j < b_hi; ++j) added_[j] = 1;
+            return;
+        }
+        compare(a_lo, a_lo + x, b_lo, b_lo + y);
+        compare(a_lo + x, a_hi, b_lo + y, b_hi);
+    }
+
+    /* runs the forward and reverse searches toward each other until their furthest
+       reaching paths overlap; (x, y) is where the optimal path crosses, relative to lo */
+    bool middle_snake(int a_lo, int a_hi, int b_lo, int b_hi, int& x_out, int& y_out) {
+        const int n = a_hi - a_lo;
+        const int m = b_hi - b_lo;
+        const int* a = a_.data() + a_lo;
+        const int* b = b_.data() + b_lo;
+
+        const int max_d = (n + m + 1) / 2;
+        const int off = max_d;
+        const int len = 2 * max_d + 2;
+        std::fill(forward_.begin(), forward_.begin() + len, -1);
+        std::fill(reverse_.begin(), reverse_.begin() + len, -1);
+        forward_[off + 1] = 0;
+        reverse_[off + 1] = 0;
+
+        const int delta = n - m;
+        const bool odd = (delta & 1) != 0;
+        int k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+
+        for (int d = 0; d < max_d; ++d) {
+            for (int k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+                int i = off + k1;
+                int x1 = (k1 == -d || (k1 != d && forward_[i - 1] < forward_[i + 1]))
+                    ? forward_[i + 1] : forward_[i - 1] + 1;
+                int y1 = x1 - k1;
+                while (x1 < n && y1 < m && a[x1] == b[y1]) { ++x1; ++y1; }
+                forward_[i] = x1;
+
+                if (x1 > n) {
+                    k1_end += 2;
+                } else if (y1 > m) {
+                    k1_start += 2;
+                } else if (odd) {
+                    int j = off + delta - k1;
+                    if (j >= 0 && j < len && reverse_[j] != -1 && x1 >= n - reverse_[j]) {
+                        x_out = x1;
+                        y_out = y1;
+                        return true;
+                    }
+                }
+            }
+
+            for (int k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+                int i = off + k2;
+                int x2 = (k2 == -d || (k2 != d && reverse_[i - 1] < reverse_[i + 1]))
+                    ? reverse_[i + 1] : reverse_[i - 1] + 1;
+                int y2 = x2 - k2;
+                while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) { ++x2; ++y2; }
+                reverse_[i] = x2;
+
+                if (x2 > n) {
+                    k2_end += 2;
+                } else if (y2 > m) {
+                    k2_start += 2;
+                } else if (!odd) {
+                    int j = off + delta - k2;
+                    if (j >= 0 && j < len && forward_[j] != -1) {
+                        int x1 = forward_[j];
+                        int y1 = off + x1 - j;
+                        if (x1 >= n - x2) {
+                            x_out = x1;
+                            y_out = y1;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+
+}
+
+std::vector<DiffLine> compute_diff(const std::vector<std::string>& old_lines,
+                                   const std::vector<std::string>& new_lines) {
+    size_t m = old_lines.size();
+    size_t n = new_lines.size();
+
+    size_t prefix = 0;
+    while (prefix < m && prefix < n && old_lines[prefix] == new_lines[prefix]) ++prefix;
+    size_t suffix = 0;
+    while (suffix < m - prefix && suffix < n - prefix &&
+           old_lines[m - 1 - suffix] == new_lines[n - 1 - suffix])
+        ++suffix;
+
+    std::unordered_map<std::string_view, int> ids;
+    ids.reserve((m + n - 2 * (prefix + suffix)) * 2);
+    auto intern = [&](const std::string& line) {
+        return ids.emplace(line, static_cast<int>(ids.size())).first->second;
+    };
+
+    std::vector<int> a, b;
+    a.reserve(m - prefix - suffix);
+    b.reserve(n - prefix - suffix);
+    for (size_t i = prefix; i < m - suffix; ++i) a.push_back(intern(old_lines[i]));
+    for (size_t j = prefix; j < n - suffix; ++j) b.push_back(intern(new_lines[j]));
+
+    MyersDiff diff(a, b);
+    diff.run();
+    const auto& removed = diff.removed();
+    const auto& added = diff.added();
+
+    std::vector<DiffLine> result;
+    result.reserve(std::max(m, n) + 16);
+    for (size_t i = 0; i < prefix; ++i) result.push_back({' ', old_lines[i]});
+
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (i < a.size() && removed[i]) {
+            result.push_back({'-', old_lines[prefix + i++]});
+        } else if (j < b.size() && added[j]) {
+            result.push_back({'+', new_lines[prefix + j++]});
+        } else {
+            result.push_back({' ', old_lines[prefix + i]});
+            ++i;
+            ++j;
+        }
+    }
+
+    for (size_t k = m - suffix; k < m; ++k) result.push_back({' ', old_lines[k]});
+    return result;
+}
+
+}
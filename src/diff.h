@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace pmt {
+
+struct DiffLine {
+    char tag;           /* ' ' unchanged, '-' removed, '+' added */
+    std::string text;
+};
+
+/* minimal line diff (Myers, linear space); removals precede additions within a hunk */
+std::vector<DiffLine> compute_diff(const std::vector<std::string>& old_lines,
+                                   const std::vector<std::string>& new_lines);
+
+}
@@ -0,0 +1,101 @@
+#include "download_progress.h"
+#include "package.h"
+#include <algorithm>
+
+namespace pmt {
+
+/* a zero expectation means sizes are learned from the transfers themselves (db syncs) */
+void DownloadProgress::begin(size_t expected_files, int64_t expected_bytes) {
+    files_.clear();
+    expected_files_ = expected_files;
+    expected_bytes_ = expected_bytes;
+    done_ = 0;
+    downloaded_ = 0;
+    known_total_ = 0;
+    finished_file_ = false;
+    started_ = Clock::now();
+    last_report_ = Clock::time_point{};
+    last_bytes_ = 0;
+    rate_ = 0.0;
+}
+
+DownloadProgress::File& DownloadProgress::file(const std::string& name) {
+    if (started_ == Clock::time_point{}) begin(0, 0);
+    return files_[name];
+}
+
+void DownloadProgress::init(const std::string& name) {
+    file(name);
+}
+
+void DownloadProgress::update(const std::string& name, int64_t downloaded, int64_t total) {
+    File& f = file(name);
+    downloaded_ += downloaded - f.downloaded;
+    known_total_ += total - f.total;
+    f.downloaded = downloaded;
+    f.total = total;
+}
+
+/* a restarted transfer reports from zero again */
+void DownloadProgress::retry(const std::string& name) {
+    update(name, 0, file(name).total);
+}
+
+void DownloadProgress::complete(const std::string& name, int64_t total, bool transferred) {
+    File& f = file(name);
+    if (f.done) return;
+    if (transferred && total > 0) update(name, total, total);
+    f.done = true;
+    done_++;
+    finished_file_ = true;
+}
+
+/* true at most every REPORT_INTERVAL_MS, or right away when a file has finished */
+bool DownloadProgress::due() {
+    auto now = Clock::now();
+    auto since = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report_).count();
+    if (!finished_file_ && since < REPORT_INTERVAL_MS) return false;
+    finished_file_ = false;
+
+    if (last_report_ != Clock::time_point{} && since > 0) {
+        double instant = static_cast<double>(downloaded_ - last_bytes_) * 1000.0 / since;
+        rate_ = rate_ > 0.0 ? rate_ * 0.7 + instant * 0.3 : instant;
+    } else {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - started_).count();
+        if (elapsed > 0) rate_ = static_cast<double>(downloaded_) * 1000.0 / elapsed;
+    }
+    last_report_ = now;
+    last_bytes_ = downloaded_;
+    return true;
+}
+
+double DownloadProgress::fraction() const {
+    int64_t total = std::max(expected_bytes_, known_total_);
+    if (total <= 0) return 0.0;
+    return std::min(1.0, static_cast<double>(downloaded_) / total);
+}
+
+/* "Downloading 12/200  3.4 MiB/s  ETA 0:42" */
+std::string DownloadProgress::label() const {
+    size_t count = std::max(expected_files_, files_.size());
+    std::string out = "Downloading " + std::to_string(done_) + "/" + std::to_string(count);
+
+    if (rate_ >= 1.0) {
+        out += "  " + format_size(static_cast<int64_t>(rate_)) + "/s";
+        int64_t total = std::max(expected_bytes_, known_total_);
+        if (total > downloaded_) {
+            int64_t eta = static_cast<int64_t>((total - downloaded_) / rate_);
+            char buf[32];
+            if (eta >= 3600)
+                snprintf(buf, sizeof(buf), "  ETA %lld:%02lld:%02lld", static_cast<long long>(eta / 3600),
+                         static_cast<long long>(eta / 60 % 60), static_cast<long long>(eta % 60));
+            else
+                snprintf(buf, sizeof(buf), "  ETA %lld:%02lld", static_cast<long long>(eta / 60),
+                         static_cast<long long>(eta % 60));
+            out += buf;
+        }
+    }
+    return out;
+}
+
+}
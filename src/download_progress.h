@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace pmt {
+
+/* folds libalpm's per-file download events into one fraction, rate and ETA;
+   due() throttles reporting so parallel transfers don't redraw on every chunk */
+class DownloadProgress {
+public:
+    static constexpr int REPORT_INTERVAL_MS = 100;
+
+    void begin(size_t expected_files, int64_t expected_bytes);
+    void init(const std::string& file);
+    void update(const std::string& file, int64_t downloaded, int64_t total);
+    void retry(const std::string& file);
+    void complete(const std::string& file, int64_t total, bool transferred);
+
+    bool due();
+    double fraction() const;
+    std::string label() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct File {
+        int64_t downloaded = 0;
+        int64_t total = 0;
+        bool done = false;
+    };
+
+    std::unordered_map<std::string, File> files_;
+    size_t expected_files_ = 0;
+    int64_t expected_bytes_ = 0;
+    size_t done_ = 0;
+    int64_t downloaded_ = 0;
+    int64_t known_total_ = 0;
+    bool finished_file_ = false;
+
+    Clock::time_point started_{};
+    Clock::time_point last_report_{};
+    int64_t last_bytes_ = 0;
+    double rate_ = 0.0;
+
+    File& file(const std::string& name);
+};
+
+}
@@ -18,6 +18,23 @@ int Input::read_byte(int timeout_ms) {
     return c;
 }
 
+/* sleeps until a key arrives, wake_fd becomes readable or timeout_ms passes (-1 waits forever) */
+int Input::wait(int wake_fd, int timeout_ms) {
+    struct pollfd pfds[2]{};
+    pfds[0].fd = STDIN_FILENO;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = wake_fd;
+    pfds[1].events = POLLIN;
+    int ret = poll(pfds, wake_fd >= 0 ? 2 : 1, timeout_ms);
+    if (ret <= 0) return Timeout;
+
+    int ready = Timeout;
+    if (pfds[0].revents & POLLIN) ready |= KeyReady;
+    else if (pfds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) ready |= Hangup;
+    if (pfds[1].revents & POLLIN) ready |= Woken;
+    return ready;
+}
+
 KeyEvent Input::read_key() {
     return read_key_timeout(-1);
 }
@@ -20,8 +20,11 @@ struct KeyEvent {
 
 class Input {
 public:
+    enum Ready { Timeout = 0, KeyReady = 1, Woken = 2, Hangup = 4 };
+
     KeyEvent read_key();
     KeyEvent read_key_timeout(int timeout_ms);
+    int wait(int wake_fd, int timeout_ms);
 
 private:
     KeyEvent decode_escape();
@@ -0,0 +1,63 @@
+#include "job_pool.h"
+
+namespace pmt {
+
+JobPool::JobPool(size_t workers) {
+    if (workers == 0) workers = 1;
+    threads_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i)
+        threads_.emplace_back([this]() { worker_loop(); });
+}
+
+JobPool::~JobPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+size_t JobPool::default_workers() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 4;
+}
+
+void JobPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(job));
+    }
+    work_cv_.notify_one();
+}
+
+/* blocks until the queue is empty and no job is running */
+void JobPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return queue_.empty() && active_ == 0; });
+}
+
+/* pending jobs are still run on shutdown so callers never lose results */
+void JobPool::worker_loop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+            ++active_;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+            if (queue_.empty() && active_ == 0) idle_cv_.notify_all();
+        }
+    }
+}
+
+}
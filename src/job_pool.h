@@ -0,0 +1,37 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace pmt {
+
+/* fixed set of worker threads draining a FIFO of jobs */
+class JobPool {
+public:
+    explicit JobPool(size_t workers);
+    ~JobPool();
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    void submit(std::function<void()> job);
+    void wait();
+    size_t workers() const { return threads_.size(); }
+
+    static size_t default_workers();
+
+private:
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    size_t active_ = 0;
+    bool stopping_ = false;
+
+    void worker_loop();
+};
+
+}
@@ -4,82 +4,92 @@
 
 namespace pmt {
 
-JsonPtr JsonValue::operator[](const std::string& key) const {
-    if (type != Object) return make_null();
-    auto it = object_val.find(key);
-    if (it == object_val.end()) return make_null();
-    return it->second;
+const JsonValue* JsonValue::null_value() {
+    static const JsonValue null{};
+    return &null;
 }
 
-JsonPtr JsonValue::operator[](size_t index) const {
-    if (type != Array || index >= array_val.size()) return make_null();
-    return array_val[index];
+const JsonValue* JsonValue::operator[](std::string_view key) const {
+    if (type != Object) return null_value();
+    /* scanned from the back so a repeated key resolves to its last value */
+    for (uint32_t i = len; i-- > 0;) {
+        if (u.members[i].key == key) return &u.members[i].value;
+    }
+    return null_value();
+}
+
+const JsonValue* JsonValue::operator[](size_t index) const {
+    if (type != Array || index >= len) return null_value();
+    return &u.elems[index];
 }
 
 std::string JsonValue::str(const std::string& def) const {
-    return type == String ? string_val : def;
+    return type == String ? std::string(u.chars, len) : def;
 }
 
 double JsonValue::num(double def) const {
-    return type == Number ? number_val : def;
+    return type == Number ? u.number_val : def;
 }
 
 int JsonValue::integer(int def) const {
-    return type == Number ? static_cast<int>(number_val) : def;
-}
-
-JsonPtr JsonValue::make_null() {
-    auto v = std::make_shared<JsonValue>();
-    v->type = Null;
-    return v;
+    return type == Number ? static_cast<int>(u.number_val) : def;
 }
 
-JsonPtr JsonValue::make_bool(bool b) {
-    auto v = std::make_shared<JsonValue>();
-    v->type = Bool;
-    v->bool_val = b;
-    return v;
+JsonValue::Range<JsonValue> JsonValue::items() const {
+    if (type != Array) return {nullptr, nullptr};
+    return {u.elems, u.elems + len};
 }
 
-JsonPtr JsonValue::make_number(double n) {
-    auto v = std::make_shared<JsonValue>();
-    v->type = Number;
-    v->number_val = n;
-    return v;
+JsonValue::Range<JsonMember> JsonValue::entries() const {
+    if (type != Object) return {nullptr, nullptr};
+    return {u.members, u.members + len};
 }
 
-JsonPtr JsonValue::make_string(const std::string& s) {
-    auto v = std::make_shared<JsonValue>();
-    v->type = String;
-    v->string_val = s;
-    return v;
+void* JsonParser::arena_alloc(size_t bytes, size_t align) {
+    size_t pad = (align - (reinterpret_cast<uintptr_t>(block_ptr_) & (align - 1))) & (align - 1);
+    if (!block_ptr_ || pad + bytes > block_left_) {
+        size_t size = bytes + align > ARENA_BLOCK ? bytes + align : ARENA_BLOCK;
+        blocks_.emplace_back(new char[size]);
+        if (blocks_.size() == 1) first_block_size_ = size;
+        block_ptr_ = blocks_.back().get();
+        block_left_ = size;
+        pad = (align - (reinterpret_cast<uintptr_t>(block_ptr_) & (align - 1))) & (align - 1);
+    }
+    char* p = block_ptr_ + pad;
+    block_ptr_ = p + bytes;
+    block_left_ -= pad + bytes;
+    return p;
 }
 
-JsonPtr JsonValue::make_array() {
-    auto v = std::make_shared<JsonValue>();
-    v->type = Array;
-    return v;
+/* keeps the first block so repeated parses do not hit the allocator */
+void JsonParser::arena_reset() {
+    if (blocks_.size() > 1) blocks_.resize(1);
+    if (!blocks_.empty()) {
+        block_ptr_ = blocks_.front().get();
+        block_left_ = first_block_size_;
+    }
 }
 
-JsonPtr JsonValue::make_object() {
-    auto v = std::make_shared<JsonValue>();
-    v->type = Object;
-    return v;
+/* parses JSON into a tree allocated from the parser's arena */
+const JsonValue* JsonParser::parse(const std::string& input) {
+    return parse(input.data(), input.size());
 }
 
-/* parses JSON string into a JsonValue tree */
-JsonPtr JsonParser::parse(const std::string& input) {
-    ptr_ = input.c_str();
-    end_ = ptr_ + input.size();
+const JsonValue* JsonParser::parse(const char* data, size_t len) {
+    ptr_ = data;
+    end_ = data + len;
     error_.clear();
+    arena_reset();
+    value_stack_.clear();
+    member_stack_.clear();
+    root_ = JsonValue{};
 
     skip_whitespace();
-    auto result = parse_value();
-    if (!result) {
+    if (!parse_value(root_)) {
         if (error_.empty()) error_ = "Failed to parse JSON";
-        return JsonValue::make_null();
+        root_ = JsonValue{};
     }
-    return result;
+    return &root_;
 }
 
 void JsonParser::skip_whitespace() {
@@ -88,134 +98,228 @@ void JsonParser::skip_whitespace() {
     }
 }
 
-JsonPtr JsonParser::parse_value() {
+bool JsonParser::parse_value(JsonValue& out) {
     if (ptr_ >= end_) {
         error_ = "Unexpected end of input";
-        return nullptr;
+        return false;
     }
 
     switch (*ptr_) {
-        case '"': return parse_string_value();
-        case '{': return parse_object();
-        case '[': return parse_array();
-        case 't': case 'f': case 'n': return parse_literal();
+        case '"': {
+            std::string_view s;
+            if (!parse_string(s)) return false;
+            out.type = JsonValue::String;
+            out.len = static_cast<uint32_t>(s.size());
+            out.u.chars = s.data();
+            return true;
+        }
+        case '{': return parse_object(out);
+        case '[': return parse_array(out);
+        case 't': case 'f': case 'n': return parse_literal(out);
         default:
             if (*ptr_ == '-' || (*ptr_ >= '0' && *ptr_ <= '9')) {
-                return parse_number();
+                return parse_number(out);
             }
             error_ = "Unexpected character: ";
             error_ += *ptr_;
-            return nullptr;
+            return false;
     }
 }
 
-JsonPtr JsonParser::parse_string_value() {
-    std::string s = parse_string();
-    if (!error_.empty()) return nullptr;
-    return JsonValue::make_string(s);
+static void append_utf8(char*& dst, unsigned cp) {
+    if (cp < 0x80) {
+        *dst++ = static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        *dst++ = static_cast<char>(0xC0 | (cp >> 6));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *dst++ = static_cast<char>(0xE0 | (cp >> 12));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        *dst++ = static_cast<char>(0xF0 | (cp >> 18));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
 }
 
-std::string JsonParser::parse_string() {
-    if (ptr_ >= end_ || *ptr_ != '"') {
-        error_ = "Expected '\"'";
-        return "";
+static bool read_hex4(const char*& p, const char* stop, unsigned& out) {
+    if (stop - p < 4) return false;
+    unsigned val = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        if (c >= '0' && c <= '9') val = val * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') val = val * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') val = val * 16 + (c - 'A' + 10);
+        else return false;
     }
-    ++ptr_;
+    p += 4;
+    out = val;
+    return true;
+}
 
-    std::string result;
-    while (ptr_ < end_ && *ptr_ != '"') {
-        if (*ptr_ == '\\') {
-            ++ptr_;
-            if (ptr_ >= end_) { error_ = "Unexpected end in string"; return ""; }
-            switch (*ptr_) {
-                case '"': result += '"'; break;
-                case '\\': result += '\\'; break;
-                case '/': result += '/'; break;
-                case 'b': result += '\b'; break;
-                case 'f': result += '\f'; break;
-                case 'n': result += '\n'; break;
-                case 'r': result += '\r'; break;
-                case 't': result += '\t'; break;
-                case 'u': {
-                    ++ptr_;
-                    char c = parse_hex4();
-                    if (error_.empty()) result += c;
-                    else return "";
-                    continue;
+/* finds the closing quote of a string body starting at p; nullptr if it is not in [p, end) */
+static const char* scan_string(const char* p, const char* end, bool& escaped) {
+    escaped = false;
+    while (p < end) {
+        const char* q = static_cast<const char*>(memchr(p, '"', static_cast<size_t>(end - p)));
+        const char* bs = static_cast<const char*>(memchr(p, '\\', static_cast<size_t>((q ? q : end) - p)));
+        if (!bs) return q;
+        escaped = true;
+        if (end - bs < 2) return nullptr;
+        p = bs + 2;
+    }
+    return nullptr;
+}
+
+/* decodes the escaped string body [p, stop) into dst, which must hold stop - p bytes */
+static const char* unescape(const char* p, const char* stop, char* dst, size_t& out_len) {
+    char* out = dst;
+    while (p < stop) {
+        if (*p != '\\') {
+            *out++ = *p++;
+            continue;
+        }
+        ++p;
+        if (p >= stop) return "Unexpected end in string";
+        switch (*p) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                ++p;
+                unsigned cp = 0;
+                if (!read_hex4(p, stop, cp)) return "Invalid hex escape";
+                if (cp >= 0xD800 && cp <= 0xDBFF && stop - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    const char* save = p;
+                    p += 2;
+                    unsigned lo = 0;
+                    if (!read_hex4(p, stop, lo)) return "Invalid hex escape";
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    } else {
+                        p = save;
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
                 }
-                default:
-                    error_ = "Invalid escape sequence";
-                    return "";
+                append_utf8(out, cp);
+                continue;
             }
-        } else {
-            result += *ptr_;
+            default:
+                return "Invalid escape sequence";
         }
-        ++ptr_;
+        ++p;
     }
+    out_len = static_cast<size_t>(out - dst);
+    return nullptr;
+}
 
-    if (ptr_ >= end_) { error_ = "Unterminated string"; return ""; }
+/* unescaped strings are views into the input; escaped ones are decoded into the arena */
+bool JsonParser::parse_string(std::string_view& out) {
+    if (ptr_ >= end_ || *ptr_ != '"') {
+        error_ = "Expected '\"'";
+        return false;
+    }
     ++ptr_;
-    return result;
-}
 
-char JsonParser::parse_hex4() {
-    if (ptr_ + 4 > end_) { error_ = "Invalid hex escape"; return 0; }
-    unsigned val = 0;
-    for (int i = 0; i < 4; ++i) {
-        char c = ptr_[i];
-        if (c >= '0' && c <= '9') val = val * 16 + (c - '0');
-        else if (c >= 'a' && c <= 'f') val = val * 16 + (c - 'a' + 10);
-        else if (c >= 'A' && c <= 'F') val = val * 16 + (c - 'A' + 10);
-        else { error_ = "Invalid hex digit"; return 0; }
+    bool escaped = false;
+    const char* start = ptr_;
+    const char* stop = scan_string(ptr_, end_, escaped);
+    if (!stop) { error_ = "Unterminated string"; return false; }
+    ptr_ = stop + 1;
+
+    if (!escaped) {
+        out = std::string_view(start, static_cast<size_t>(stop - start));
+        return true;
+    }
+
+    /* decoded output is never longer than the escaped source */
+    char* buf = static_cast<char*>(arena_alloc(static_cast<size_t>(stop - start), 1));
+    size_t len = 0;
+    if (const char* err = unescape(start, stop, buf, len)) {
+        error_ = err;
+        return false;
     }
-    ptr_ += 4;
-    return static_cast<char>(val & 0x7F);
+    out = std::string_view(buf, len);
+    return true;
 }
 
-JsonPtr JsonParser::parse_number() {
+bool JsonParser::parse_number(JsonValue& out) {
     const char* start = ptr_;
-    if (*ptr_ == '-') ++ptr_;
-
-    while (ptr_ < end_ && *ptr_ >= '0' && *ptr_ <= '9') ++ptr_;
+    bool negative = false;
+    if (*ptr_ == '-') { negative = true; ++ptr_; }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    while (ptr_ < end_ && *ptr_ >= '0' && *ptr_ <= '9') {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*ptr_ - '0');
+        ++digits;
+        ++ptr_;
+    }
+    bool integral = true;
     if (ptr_ < end_ && *ptr_ == '.') {
+        integral = false;
         ++ptr_;
         while (ptr_ < end_ && *ptr_ >= '0' && *ptr_ <= '9') ++ptr_;
     }
     if (ptr_ < end_ && (*ptr_ == 'e' || *ptr_ == 'E')) {
+        integral = false;
         ++ptr_;
         if (ptr_ < end_ && (*ptr_ == '+' || *ptr_ == '-')) ++ptr_;
         while (ptr_ < end_ && *ptr_ >= '0' && *ptr_ <= '9') ++ptr_;
     }
 
-    std::string numstr(start, ptr_);
-    double val = std::strtod(numstr.c_str(), nullptr);
-    return JsonValue::make_number(val);
+    out.type = JsonValue::Number;
+    if (integral && digits <= 15) {
+        double v = static_cast<double>(mantissa);
+        out.u.number_val = negative ? -v : v;
+        return true;
+    }
+
+    char buf[64];
+    size_t n = static_cast<size_t>(ptr_ - start);
+    if (n >= sizeof(buf)) n = sizeof(buf) - 1;
+    memcpy(buf, start, n);
+    buf[n] = '\0';
+    out.u.number_val = std::strtod(buf, nullptr);
+    return true;
 }
 
-JsonPtr JsonParser::parse_object() {
-    if (ptr_ >= end_ || *ptr_ != '{') { error_ = "Expected '{'"; return nullptr; }
+bool JsonParser::parse_object(JsonValue& out) {
+    if (ptr_ >= end_ || *ptr_ != '{') { error_ = "Expected '{'"; return false; }
     ++ptr_;
     skip_whitespace();
 
-    auto obj = JsonValue::make_object();
+    out.type = JsonValue::Object;
+    out.len = 0;
+    out.u.members = nullptr;
 
-    if (ptr_ < end_ && *ptr_ == '}') { ++ptr_; return obj; }
+    if (ptr_ < end_ && *ptr_ == '}') { ++ptr_; return true; }
 
+    size_t base = member_stack_.size();
     while (ptr_ < end_) {
         skip_whitespace();
-        if (ptr_ >= end_ || *ptr_ != '"') { error_ = "Expected string key"; return nullptr; }
-        std::string key = parse_string();
-        if (!error_.empty()) return nullptr;
+        if (ptr_ >= end_ || *ptr_ != '"') { error_ = "Expected string key"; return false; }
+        std::string_view key;
+        if (!parse_string(key)) return false;
 
         skip_whitespace();
-        if (ptr_ >= end_ || *ptr_ != ':') { error_ = "Expected ':'"; return nullptr; }
+        if (ptr_ >= end_ || *ptr_ != ':') { error_ = "Expected ':'"; return false; }
         ++ptr_;
         skip_whitespace();
 
-        auto val = parse_value();
-        if (!val) return nullptr;
+        JsonValue val;
+        if (!parse_value(val)) return false;
 
-        obj->object_val[key] = val;
+        member_stack_.push_back({key, val});
 
         skip_whitespace();
         if (ptr_ < end_ && *ptr_ == ',') {
@@ -226,25 +330,36 @@ JsonPtr JsonParser::parse_object() {
     }
 
     skip_whitespace();
-    if (ptr_ >= end_ || *ptr_ != '}') { error_ = "Expected '}'"; return nullptr; }
+    if (ptr_ >= end_ || *ptr_ != '}') { error_ = "Expected '}'"; return false; }
     ++ptr_;
-    return obj;
+
+    size_t count = member_stack_.size() - base;
+    auto* members = static_cast<JsonMember*>(arena_alloc(count * sizeof(JsonMember), alignof(JsonMember)));
+    memcpy(static_cast<void*>(members), member_stack_.data() + base, count * sizeof(JsonMember));
+    member_stack_.resize(base);
+
+    out.len = static_cast<uint32_t>(count);
+    out.u.members = members;
+    return true;
 }
 
-JsonPtr JsonParser::parse_array() {
-    if (ptr_ >= end_ || *ptr_ != '[') { error_ = "Expected '['"; return nullptr; }
+bool JsonParser::parse_array(JsonValue& out) {
+    if (ptr_ >= end_ || *ptr_ != '[') { error_ = "Expected '['"; return false; }
     ++ptr_;
     skip_whitespace();
 
-    auto arr = JsonValue::make_array();
+    out.type = JsonValue::Array;
+    out.len = 0;
+    out.u.elems = nullptr;
 
-    if (ptr_ < end_ && *ptr_ == ']') { ++ptr_; return arr; }
+    if (ptr_ < end_ && *ptr_ == ']') { ++ptr_; return true; }
 
+    size_t base = value_stack_.size();
     while (ptr_ < end_) {
         skip_whitespace();
-        auto val = parse_value();
-        if (!val) return nullptr;
-        arr->array_val.push_back(val);
+        JsonValue val;
+        if (!parse_value(val)) return false;
+        value_stack_.push_back(val);
 
         skip_whitespace();
         if (ptr_ < end_ && *ptr_ == ',') {
@@ -255,26 +370,203 @@ JsonPtr JsonParser::parse_array() {
     }
 
     skip_whitespace();
-    if (ptr_ >= end_ || *ptr_ != ']') { error_ = "Expected ']'"; return nullptr; }
+    if (ptr_ >= end_ || *ptr_ != ']') { error_ = "Expected ']'"; return false; }
     ++ptr_;
-    return arr;
+
+    size_t count = value_stack_.size() - base;
+    auto* elems = static_cast<JsonValue*>(arena_alloc(count * sizeof(JsonValue), alignof(JsonValue)));
+    memcpy(static_cast<void*>(elems), value_stack_.data() + base, count * sizeof(JsonValue));
+    value_stack_.resize(base);
+
+    out.len = static_cast<uint32_t>(count);
+    out.u.elems = elems;
+    return true;
 }
 
-JsonPtr JsonParser::parse_literal() {
+bool JsonParser::parse_literal(JsonValue& out) {
     if (end_ - ptr_ >= 4 && std::strncmp(ptr_, "true", 4) == 0) {
         ptr_ += 4;
-        return JsonValue::make_bool(true);
+        out.type = JsonValue::Bool;
+        out.bool_val = true;
+        return true;
     }
     if (end_ - ptr_ >= 5 && std::strncmp(ptr_, "false", 5) == 0) {
         ptr_ += 5;
-        return JsonValue::make_bool(false);
+        out.type = JsonValue::Bool;
+        out.bool_val = false;
+        return true;
     }
     if (end_ - ptr_ >= 4 && std::strncmp(ptr_, "null", 4) == 0) {
         ptr_ += 4;
-        return JsonValue::make_null();
+        out.type = JsonValue::Null;
+        return true;
     }
     error_ = "Invalid literal";
-    return nullptr;
+    return false;
+}
+
+
+bool JsonStreamParser::fail(const char* msg) {
+    failed_ = true;
+    error_ = msg;
+    return false;
+}
+
+bool JsonStreamParser::stop() {
+    failed_ = true;
+    stopped_ = true;
+    error_ = "Cancelled";
+    return false;
+}
+
+void JsonStreamParser::after_value() {
+    if (stack_.empty()) state_ = Done;
+    else state_ = stack_.back() == '{' ? ObjectCommaOrEnd : ArrayCommaOrEnd;
+}
+
+static bool is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/* consumes whole tokens from [begin, end) and returns how many bytes were used;
+   a token cut off by the end of the buffer is left for the next call unless final */
+size_t JsonStreamParser::consume(const char* begin, const char* end, bool final) {
+    const char* p = begin;
+    while (p < end && !failed_) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+        if (p >= end) break;
+        char c = *p;
+
+        switch (state_) {
+            case Done:
+                fail("Trailing data after JSON value");
+                break;
+
+            case Colon:
+                if (c != ':') { fail("Expected ':'"); break; }
+                ++p;
+                state_ = Value;
+                break;
+
+            case ObjectCommaOrEnd:
+            case ArrayCommaOrEnd: {
+                char close = state_ == ObjectCommaOrEnd ? '}' : ']';
+                if (c == ',') {
+                    ++p;
+                    state_ = state_ == ObjectCommaOrEnd ? ObjectKey : Value;
+                } else if (c == close) {
+                    ++p;
+                    stack_.pop_back();
+                    if (!(close == '}' ? handler_.end_object() : handler_.end_array())) { stop(); break; }
+                    after_value();
+                } else {
+                    fail(close == '}' ? "Expected '}'" : "Expected ']'");
+                }
+                break;
+            }
+
+            case ObjectKeyOrEnd:
+            case ArrayValueOrEnd:
+                if ((state_ == ObjectKeyOrEnd && c == '}') || (state_ == ArrayValueOrEnd && c == ']')) {
+                    ++p;
+                    stack_.pop_back();
+                    if (!(c == '}' ? handler_.end_object() : handler_.end_array())) { stop(); break; }
+                    after_value();
+                    break;
+                }
+                state_ = state_ == ObjectKeyOrEnd ? ObjectKey : Value;
+                break;
+
+            case ObjectKey:
+            case Value: {
+                if (c == '"') {
+                    bool escaped = false;
+                    const char* stop_at = scan_string(p + 1, end, escaped);
+                    if (!stop_at) {
+                        if (final) fail("Unterminated string");
+                        return static_cast<size_t>(p - begin);
+                    }
+                    std::string_view sv(p + 1, static_cast<size_t>(stop_at - p - 1));
+                    if (escaped) {
+                        scratch_.resize(sv.size());
+                        size_t len = 0;
+                        if (const char* err = unescape(sv.data(), stop_at, scratch_.data(), len)) {
+                            fail(err);
+                            break;
+                        }
+                        sv = std::string_view(scratch_.data(), len);
+                    }
+                    p = stop_at + 1;
+                    if (state_ == ObjectKey) {
+                        if (!handler_.on_key(sv)) { stop(); break; }
+                        state_ = Colon;
+                    } else {
+                        if (!handler_.on_string(sv)) { stop(); break; }
+                        after_value();
+                    }
+                    break;
+                }
+                if (state_ == ObjectKey) { fail("Expected string key"); break; }
+
+                if (c == '{' || c == '[') {
+                    ++p;
+                    stack_.push_back(c);
+                    if (!(c == '{' ? handler_.begin_object() : handler_.begin_array())) { stop(); break; }
+                    state_ = c == '{' ? ObjectKeyOrEnd : ArrayValueOrEnd;
+                } else if (c == 't' || c == 'f' || c == 'n') {
+                    const char* word = c == 't' ? "true" : c == 'f' ? "false" : "null";
+                    size_t wlen = strlen(word);
+                    if (static_cast<size_t>(end - p) < wlen) {
+                        if (final || strncmp(p, word, static_cast<size_t>(end - p)) != 0) fail("Invalid literal");
+                        return static_cast<size_t>(p - begin);
+                    }
+                    if (strncmp(p, word, wlen) != 0) { fail("Invalid literal"); break; }
+                    p += wlen;
+                    bool ok = c == 'n' ? handler_.on_null() : handler_.on_bool(c == 't');
+                    if (!ok) { stop(); break; }
+                    after_value();
+                } else if (c == '-' || (c >= '0' && c <= '9')) {
+                    const char* q = p;
+                    while (q < end && is_number_char(*q)) ++q;
+                    if (q == end && !final) return static_cast<size_t>(p - begin);
+                    char buf[64];
+                    size_t n = static_cast<size_t>(q - p);
+                    if (n >= sizeof(buf)) n = sizeof(buf) - 1;
+                    memcpy(buf, p, n);
+                    buf[n] = '\0';
+                    p = q;
+                    if (!handler_.on_number(std::strtod(buf, nullptr))) { stop(); break; }
+                    after_value();
+                } else {
+                    fail("Unexpected character");
+                }
+                break;
+            }
+        }
+    }
+    return static_cast<size_t>(p - begin);
+}
+
+bool JsonStreamParser::feed(const char* data, size_t len) {
+    if (failed_) return false;
+    if (carry_.empty()) {
+        size_t used = consume(data, data + len, false);
+        if (!failed_) carry_.assign(data + used, len - used);
+    } else {
+        carry_.append(data, len);
+        size_t used = consume(carry_.data(), carry_.data() + carry_.size(), false);
+        carry_.erase(0, used);
+    }
+    return !failed_;
+}
+
+bool JsonStreamParser::finish() {
+    if (failed_) return false;
+    consume(carry_.data(), carry_.data() + carry_.size(), true);
+    carry_.clear();
+    if (failed_) return false;
+    if (state_ != Done) return fail("Unexpected end of input");
+    return true;
 }
 
 }
@@ -1,49 +1,118 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include <memory>
+#include <cstdint>
 
 namespace pmt {
 
-struct JsonValue;
-using JsonPtr = std::shared_ptr<JsonValue>;
-
-using JsonObject = std::map<std::string, JsonPtr>;
-using JsonArray = std::vector<JsonPtr>;
+struct JsonMember;
 
+/* compact tagged value; strings, elements and members live in the parser's arena */
 struct JsonValue {
-    enum Type { Null, Bool, Number, String, Array, Object };
+    enum Type : uint8_t { Null, Bool, Number, String, Array, Object };
 
     Type type = Null;
     bool bool_val = false;
-    double number_val = 0.0;
-    std::string string_val;
-    JsonArray array_val;
-    JsonObject object_val;
+    uint32_t len = 0;
+    union {
+        double number_val;
+        const char* chars;
+        const JsonValue* elems;
+        const JsonMember* members;
+    } u{};
 
     bool is_null() const { return type == Null; }
     bool is_array() const { return type == Array; }
     bool is_object() const { return type == Object; }
+    bool is_string() const { return type == String; }
+    size_t size() const { return (type == Array || type == Object) ? len : 0; }
 
-    JsonPtr operator[](const std::string& key) const;
-    JsonPtr operator[](size_t index) const;
+    const JsonValue* operator[](std::string_view key) const;
+    const JsonValue* operator[](size_t index) const;
 
+    std::string_view view() const { return type == String ? std::string_view(u.chars, len) : std::string_view(); }
     std::string str(const std::string& def = "") const;
     double num(double def = 0.0) const;
     int integer(int def = 0) const;
 
-    static JsonPtr make_null();
-    static JsonPtr make_bool(bool v);
-    static JsonPtr make_number(double v);
-    static JsonPtr make_string(const std::string& v);
-    static JsonPtr make_array();
-    static JsonPtr make_object();
+    template <typename T>
+    struct Range {
+        const T* first;
+        const T* last;
+        const T* begin() const { return first; }
+        const T* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    Range<JsonValue> items() const;
+    Range<JsonMember> entries() const;
+
+    static const JsonValue* null_value();
+};
+
+struct JsonMember {
+    std::string_view key;
+    JsonValue value;
+};
+
+/* receives JsonStreamParser events; strings are only valid for the duration of the call,
+   and returning false stops the parse */
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+    virtual bool on_null() { return true; }
+    virtual bool on_bool(bool) { return true; }
+    virtual bool on_number(double) { return true; }
+    virtual bool on_string(std::string_view) { return true; }
+    virtual bool on_key(std::string_view) { return true; }
+    virtual bool begin_object() { return true; }
+    virtual bool end_object() { return true; }
+    virtual bool begin_array() { return true; }
+    virtual bool end_array() { return true; }
+};
+
+/* incremental push parser; input may be split at any byte boundary across feed() calls */
+class JsonStreamParser {
+public:
+    explicit JsonStreamParser(JsonHandler& handler) : handler_(handler) {}
+
+    bool feed(const char* data, size_t len);
+    bool finish();
+    bool stopped() const { return stopped_; }
+    std::string error() const { return error_; }
+
+private:
+    enum State : uint8_t {
+        Value, ArrayValueOrEnd, ArrayCommaOrEnd,
+        ObjectKeyOrEnd, ObjectKey, Colon, ObjectCommaOrEnd, Done,
+    };
+
+    JsonHandler& handler_;
+    State state_ = Value;
+    std::vector<char> stack_;
+    std::string carry_;
+    std::string scratch_;
+    std::string error_;
+    bool failed_ = false;
+    bool stopped_ = false;
+
+    size_t consume(const char* begin, const char* end, bool final);
+    bool fail(const char* msg);
+    bool stop();
+    void after_value();
 };
 
+/* the returned tree borrows from the input buffer and the parser; both must outlive it */
 class JsonParser {
 public:
-    JsonPtr parse(const std::string& input);
+    JsonParser() = default;
+    JsonParser(const JsonParser&) = delete;
+    JsonParser& operator=(const JsonParser&) = delete;
+
+    const JsonValue* parse(const std::string& input);
+    const JsonValue* parse(const char* data, size_t len);
     std::string error() const { return error_; }
 
 private:
@@ -51,15 +120,26 @@ private:
     const char* end_ = nullptr;
     std::string error_;
 
+    static constexpr size_t ARENA_BLOCK = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_ptr_ = nullptr;
+    size_t block_left_ = 0;
+    size_t first_block_size_ = 0;
+
+    std::vector<JsonValue> value_stack_;
+    std::vector<JsonMember> member_stack_;
+    JsonValue root_;
+
+    void* arena_alloc(size_t bytes, size_t align);
+    void arena_reset();
+
     void skip_whitespace();
-    JsonPtr parse_value();
-    JsonPtr parse_string_value();
-    JsonPtr parse_number();
-    JsonPtr parse_object();
-    JsonPtr parse_array();
-    JsonPtr parse_literal();
-    std::string parse_string();
-    char parse_hex4();
+    bool parse_value(JsonValue& out);
+    bool parse_number(JsonValue& out);
+    bool parse_object(JsonValue& out);
+    bool parse_array(JsonValue& out);
+    bool parse_literal(JsonValue& out);
+    bool parse_string(std::string_view& out);
 };
 
 }
@@ -0,0 +1,25 @@
+#include "log_buffer.h"
+
+namespace pmt {
+
+LogBuffer::LogBuffer(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+/* overwrites the oldest slot once full, reusing its allocation */
+void LogBuffer::push(std::string_view line) {
+    if (line.size() > MAX_LINE) {
+        size_t cut = MAX_LINE;
+        while (cut > 0 && (static_cast<unsigned char>(line[cut]) & 0xC0) == 0x80) --cut;
+        line = line.substr(0, cut);
+    }
+
+    if (lines_.size() < capacity_) lines_.emplace_back(line);
+    else lines_[total_ % capacity_].assign(line.data(), line.size());
+    ++total_;
+}
+
+void LogBuffer::clear() {
+    lines_.clear();
+    total_ = 0;
+}
+
+}
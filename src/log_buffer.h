@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace pmt {
+
+/* fixed-capacity ring of the most recent log lines, addressed by absolute line number;
+   anything older lives only in the on-disk log */
+class LogBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+    static constexpr size_t MAX_LINE = 1024;
+
+    explicit LogBuffer(size_t capacity = DEFAULT_CAPACITY);
+
+    void push(std::string_view line);
+    void clear();
+
+    bool empty() const { return total_ == 0; }
+    size_t size() const { return lines_.size(); }
+    uint64_t total() const { return total_; }
+    uint64_t first() const { return total_ - lines_.size(); }
+
+    /* abs must be in [first(), total()) */
+    const std::string& at(uint64_t abs) const { return lines_[abs % capacity_]; }
+    const std::string& back() const { return at(total_ - 1); }
+
+private:
+    size_t capacity_;
+    std::vector<std::string> lines_;
+    uint64_t total_ = 0;
+};
+
+}
@@ -1,8 +1,37 @@
 #include "app.h"
+#include "cli.h"
 #include <cstdio>
 #include <cstring>
+#include <cstdlib>
+
+static void print_usage() {
+    printf("Usage: pmt [OPTIONS]\n");
+    printf("       pmt --json search <query>\n");
+    printf("       pmt --json updates\n");
+    printf("       pmt --resolve <package>\n\n");
+    printf("Options:\n");
+    printf("  --disable-color       Disable all colors (monochrome mode)\n");
+    printf("  --accent <#RRGGBB>    Set custom accent color\n");
+    printf("  -j, --jobs <N>        Parallel AUR jobs (default: CPU count)\n");
+    printf("  --timing              Print startup phase timings on exit\n");
+    printf("  --trace <file>        Write a Chrome trace of instrumented calls\n");
+    printf("  -h, --help            Show this help\n\n");
+    printf("Headless modes print one JSON object per line and never touch the terminal.\n");
+}
 
 int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage();
+            return 0;
+        }
+    }
+
+    if (pmt::Cli::requested(argc, argv)) {
+        pmt::Cli cli;
+        return cli.run(argc, argv);
+    }
+
     pmt::App app;
 
     for (int i = 1; i < argc; ++i) {
@@ -10,13 +39,16 @@ int main(int argc, char* argv[]) {
             app.color_disabled = true;
         } else if (strcmp(argv[i], "--accent") == 0 && i + 1 < argc) {
             app.accent_hex = argv[++i];
-        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
-            printf("Usage: pmt [OPTIONS]\n\n");
-            printf("Options:\n");
-            printf("  --disable-color       Disable all colors (monochrome mode)\n");
-            printf("  --accent <#RRGGBB>    Set custom accent color\n");
-            printf("  -h, --help            Show this help\n");
-            return 0;
+        } else if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+            app.max_jobs = atoi(argv[++i]);
+            if (app.max_jobs < 1) {
+                fprintf(stderr, "Invalid job count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--timing") == 0) {
+            app.timing = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            app.trace_path = argv[++i];
         } else {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
             fprintf(stderr, "Try 'pmt --help' for usage.\n");
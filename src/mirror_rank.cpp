@@ -0,0 +1,165 @@
+#include "mirror_rank.h"
+#include "job_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace pmt {
+
+/* "host:port" of a URL; empty for local schemes, which need no probe */
+std::string MirrorRanker::endpoint(const std::string& url) {
+    size_t scheme_end = url.find("://");
+    if (scheme_end == std::string::npos) return "";
+    std::string scheme = url.substr(0, scheme_end);
+    const char* port;
+    if (scheme == "https") port = "443";
+    else if (scheme == "http") port = "80";
+    else if (scheme == "ftp") port = "21";
+    else return "";
+
+    size_t host_start = scheme_end + 3;
+    size_t host_end = url.find('/', host_start);
+    std::string host = url.substr(host_start, host_end == std::string::npos
+                                                  ? std::string::npos : host_end - host_start);
+    size_t at = host.rfind('@');
+    if (at != std::string::npos) host.erase(0, at + 1);
+    if (host.empty()) return "";
+    if (host.find(':') != std::string::npos && host.back() != ']') return host;
+    return host + ":" + port;
+}
+
+namespace {
+
+/* getaddrinfo has no timeout of its own, so it runs on a detached thread; whoever
+   drops the last reference frees the result, letting an abandoned lookup finish late */
+struct Lookup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    struct addrinfo* res = nullptr;
+
+    ~Lookup() {
+        if (res) freeaddrinfo(res);
+    }
+};
+
+}
+
+/* milliseconds until a non-blocking connect completes, UNREACHABLE on error or timeout;
+   resolution and every address tried share one deadline */
+int MirrorRanker::probe(const std::string& endpoint, int timeout_ms) {
+    using Clock = std::chrono::steady_clock;
+    size_t colon = endpoint.rfind(':');
+    std::string host = endpoint.substr(0, colon);
+    std::string port = endpoint.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::milliseconds(timeout_ms);
+
+    auto lookup = std::make_shared<Lookup>();
+    std::thread([lookup, host, port]() {
+        struct addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) res = nullptr;
+        std::lock_guard<std::mutex> lock(lookup->mutex);
+        lookup->res = res;
+        lookup->done = true;
+        lookup->cv.notify_all();
+    }).detach();
+
+    {
+        std::unique_lock<std::mutex> lock(lookup->mutex);
+        if (!lookup->cv.wait_until(lock, deadline, [&] { return lookup->done; })) return UNREACHABLE;
+    }
+
+    for (struct addrinfo* ai = lookup->res; ai; ai = ai->ai_next) {
+        int remaining = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (remaining <= 0) break;
+
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+
+        bool connected = false;
+        int ret = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (ret == 0) {
+            connected = true;
+        } else if (errno == EINPROGRESS) {
+            struct pollfd pfd{fd, POLLOUT, 0};
+            int err = 0;
+            socklen_t len = sizeof(err);
+            connected = poll(&pfd, 1, remaining) == 1 &&
+                        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+        }
+        close(fd);
+
+        /* an address family the host can't route fails at once and the next one is tried */
+        if (connected) {
+            return static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count());
+        }
+    }
+    return UNREACHABLE;
+}
+
+bool MirrorRanker::needs_probe(const std::vector<std::string>& urls) const {
+    for (const auto& url : urls) {
+        std::string ep = endpoint(url);
+        if (!ep.empty() && !latency_ms_.count(ep)) return true;
+    }
+    return false;
+}
+
+void MirrorRanker::rank(std::vector<std::string>& urls) {
+    std::vector<std::string> pending;
+    for (const auto& url : urls) {
+        std::string ep = endpoint(url);
+        if (ep.empty() || latency_ms_.count(ep)) continue;
+        if (std::find(pending.begin(), pending.end(), ep) != pending.end()) continue;
+        if (pending.size() >= MAX_PROBES) break;
+        pending.push_back(ep);
+    }
+
+    if (!pending.empty()) {
+        std::vector<int> results(pending.size(), UNREACHABLE);
+        {
+            JobPool pool(pending.size());
+            for (size_t i = 0; i < pending.size(); ++i)
+                pool.submit([&, i]() { results[i] = probe(pending[i], PROBE_TIMEOUT_MS); });
+            pool.wait();
+        }
+        for (size_t i = 0; i < pending.size(); ++i)
+            latency_ms_[pending[i]] = results[i];
+    }
+
+    /* local servers first, then by latency; hosts past the probe budget keep their
+       place ahead of unreachable ones */
+    auto key = [this](const std::string& url) {
+        std::string ep = endpoint(url);
+        if (ep.empty()) return -1;
+        auto it = latency_ms_.find(ep);
+        if (it == latency_ms_.end()) return INT_MAX - 1;
+        return it->second == UNREACHABLE ? INT_MAX : it->second;
+    };
+    std::vector<std::pair<int, std::string>> keyed;
+    keyed.reserve(urls.size());
+    for (auto& url : urls) keyed.emplace_back(key(url), std::move(url));
+    std::stable_sort(keyed.begin(), keyed.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < urls.size(); ++i) urls[i] = std::move(keyed[i].second);
+}
+
+}
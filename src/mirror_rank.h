@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pmt {
+
+/* orders mirror URLs by TCP connect latency to their host; results are kept
+   for the process lifetime so later syncs reuse one round of probes */
+class MirrorRanker {
+public:
+    static constexpr int PROBE_TIMEOUT_MS = 1000;
+    static constexpr size_t MAX_PROBES = 16;
+    static constexpr int UNREACHABLE = -1;
+
+    void rank(std::vector<std::string>& urls);
+    bool needs_probe(const std::vector<std::string>& urls) const;
+
+private:
+    std::unordered_map<std::string, int> latency_ms_;
+
+    static std::string endpoint(const std::string& url);
+    static int probe(const std::string& endpoint, int timeout_ms);
+};
+
+}
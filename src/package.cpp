@@ -3,6 +3,26 @@
 
 namespace pmt {
 
+/* wraps an already complete PackageInfo (AUR results) as a list row */
+PackageRow make_row(PackageInfo info) {
+    PackageRow row;
+    row.name = info.name;
+    row.version = info.version;
+    row.repo = info.repo;
+    row.installed_version = info.installed_version;
+    row.download_size = info.download_size;
+    row.install_size = info.install_size;
+    row.build_date = info.build_date;
+    row.install_date = info.install_date;
+    row.source = info.source;
+    row.installed = info.installed;
+    row.has_update = info.has_update;
+    row.aur_out_of_date = info.aur_out_of_date;
+    row.aur_votes = info.aur_votes;
+    row.details = std::make_shared<const PackageInfo>(std::move(info));
+    return row;
+}
+
 std::string format_size(int64_t bytes) {
     if (bytes < 0) return "0 B";
     const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
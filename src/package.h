@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory>
 
 namespace pmt {
 
@@ -39,8 +40,31 @@ struct PackageInfo {
     int aur_votes = 0;
     std::string aur_maintainer;
     bool aur_out_of_date = false;
+    int64_t aur_last_modified = 0;
 };
 
+/* lightweight list entry; full details are materialized on selection */
+struct PackageRow {
+    std::string name;
+    std::string version;
+    std::string repo;
+    std::string installed_version;
+    int64_t download_size = 0;
+    int64_t install_size = 0;
+    int64_t build_date = 0;
+    int64_t install_date = 0;
+    PackageSource source = PackageSource::Sync;
+    bool installed = false;
+    bool has_update = false;
+    bool aur_out_of_date = false;
+    int aur_votes = 0;
+
+    void* handle = nullptr;
+    uint64_t handle_gen = 0;
+    std::shared_ptr<const PackageInfo> details;
+};
+
+PackageRow make_row(PackageInfo info);
 std::string format_size(int64_t bytes);
 std::string format_date(int64_t timestamp);
 
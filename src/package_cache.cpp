@@ -0,0 +1,136 @@
+#include "package_cache.h"
+#include "job_pool.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace pmt {
+
+namespace {
+
+int64_t mtime_ns(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+}
+
+/* keeps already scanned directories that are still wanted, so their files survive
+   until the next refresh decides whether they changed */
+void PackageCache::set_dirs(const std::vector<std::string>& dirs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Dir> next;
+    next.reserve(dirs.size());
+    for (const auto& path : dirs) {
+        std::string p = path;
+        if (p.empty()) continue;
+        if (p.back() != '/') p += '/';
+        auto it = std::find_if(dirs_.begin(), dirs_.end(),
+                               [&](const Dir& d) { return d.path == p; });
+        if (it != dirs_.end()) next.push_back(std::move(*it));
+        else next.push_back({p, -1, {}});
+    }
+    dirs_ = std::move(next);
+    rebuild_index_locked();
+}
+
+/* name-pkgver-pkgrel-arch.pkg.tar[.ext], split from the right since names contain
+   dashes; signatures and partial downloads are not packages */
+bool PackageCache::parse_filename(const std::string& filename, CachedPackage& out) {
+    size_t ext = filename.rfind(".pkg.tar");
+    if (ext == std::string::npos || ext == 0) return false;
+    std::string suffix = filename.substr(ext + 8);
+    if (!suffix.empty() && (suffix[0] != '.' || suffix.find('.', 1) != std::string::npos))
+        return false;
+
+    size_t arch_dash = filename.rfind('-', ext - 1);
+    if (arch_dash == std::string::npos || arch_dash == 0) return false;
+    size_t rel_dash = filename.rfind('-', arch_dash - 1);
+    if (rel_dash == std::string::npos || rel_dash == 0) return false;
+    size_t ver_dash = filename.rfind('-', rel_dash - 1);
+    if (ver_dash == std::string::npos || ver_dash == 0) return false;
+
+    out.arch = filename.substr(arch_dash + 1, ext - arch_dash - 1);
+    out.version = filename.substr(ver_dash + 1, arch_dash - ver_dash - 1);
+    out.name = filename.substr(0, ver_dash);
+    return !out.arch.empty() && rel_dash > ver_dash + 1 && arch_dash > rel_dash + 1;
+}
+
+void PackageCache::scan_dir(Dir& dir) {
+    dir.files.clear();
+    int fd = open(dir.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        dir.mtime_ns = -1;
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == 0) dir.mtime_ns = mtime_ns(st);
+
+    DIR* d = fdopendir(fd);
+    if (!d) {
+        close(fd);
+        return;
+    }
+    while (struct dirent* entry = readdir(d)) {
+        if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) continue;
+        CachedPackage pkg;
+        if (!parse_filename(entry->d_name, pkg)) continue;
+        if (fstatat(fd, entry->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) continue;
+        pkg.path = dir.path + entry->d_name;
+        pkg.size = static_cast<uint64_t>(st.st_size);
+        pkg.mtime = static_cast<int64_t>(st.st_mtim.tv_sec);
+        dir.files.push_back(std::move(pkg));
+    }
+    closedir(d);
+}
+
+/* adding or removing a file bumps its directory's mtime; unchanged directories are
+   kept as they are and the stale ones are scanned in parallel */
+void PackageCache::refresh() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Dir*> stale;
+    for (auto& dir : dirs_) {
+        struct stat st{};
+        int64_t now = stat(dir.path.c_str(), &st) == 0 ? mtime_ns(st) : -1;
+        if (now != dir.mtime_ns || now < 0) stale.push_back(&dir);
+    }
+    if (stale.empty()) return;
+
+    if (stale.size() == 1) {
+        scan_dir(*stale[0]);
+    } else {
+        JobPool pool(std::min(stale.size(), JobPool::default_workers()));
+        for (Dir* dir : stale)
+            pool.submit([dir]() { scan_dir(*dir); });
+        pool.wait();
+    }
+    rebuild_index_locked();
+}
+
+void PackageCache::rebuild_index_locked() {
+    by_name_.clear();
+    for (const auto& dir : dirs_)
+        for (const auto& pkg : dir.files)
+            by_name_[pkg.name].push_back(&pkg);
+}
+
+std::vector<CachedPackage> PackageCache::find(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<CachedPackage> out;
+    auto it = by_name_.find(name);
+    if (it == by_name_.end()) return out;
+    out.reserve(it->second.size());
+    for (const CachedPackage* pkg : it->second) out.push_back(*pkg);
+    return out;
+}
+
+std::vector<CachedPackage> PackageCache::all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<CachedPackage> out;
+    for (const auto& dir : dirs_)
+        out.insert(out.end(), dir.files.begin(), dir.files.end());
+    return out;
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace pmt {
+
+struct CachedPackage {
+    std::string name;
+    std::string version;    /* [epoch:]pkgver-pkgrel */
+    std::string arch;
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+/* catalog of the package files in a set of cache directories, indexed by package
+   name; refresh() rescans only the directories whose mtime moved since last time */
+class PackageCache {
+public:
+    void set_dirs(const std::vector<std::string>& dirs);
+    void refresh();
+
+    std::vector<CachedPackage> find(const std::string& name);
+    std::vector<CachedPackage> all();
+
+    static bool parse_filename(const std::string& filename, CachedPackage& out);
+
+private:
+    struct Dir {
+        std::string path;
+        int64_t mtime_ns = -1;
+        std::vector<CachedPackage> files;
+    };
+
+    std::mutex mutex_;
+    std::vector<Dir> dirs_;
+    std::unordered_map<std::string, std::vector<const CachedPackage*>> by_name_;
+
+    static void scan_dir(Dir& dir);
+    void rebuild_index_locked();
+};
+
+}
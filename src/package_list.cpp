@@ -0,0 +1,91 @@
+#include "package_list.h"
+#include <algorithm>
+#include <numeric>
+
+namespace pmt {
+
+/* big-endian first 8 bytes, so integer order matches byte-wise string order */
+static uint64_t name_prefix_key(const std::string& name) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        key <<= 8;
+        if (i < name.size()) key |= static_cast<unsigned char>(name[i]);
+    }
+    return key;
+}
+
+/* prev's rows followed by more; when the caller held the last reference to a set made
+   here, its rows are moved instead of copied, so a streamed result grows in O(delta) */
+ResultSetPtr ResultSet::extend(ResultSetPtr prev, std::vector<PackageRow> more) {
+    std::vector<PackageRow> rows;
+    if (prev && prev->extendable_ && prev.use_count() == 1) {
+        /* extendable sets are only ever created non-const, below */
+        rows = std::move(const_cast<ResultSet&>(*prev).rows_);
+    } else if (prev) {
+        rows = prev->rows_;
+    }
+    prev.reset();
+    rows.reserve(rows.size() + more.size());
+    for (auto& row : more) rows.push_back(std::move(row));
+    auto set = std::make_shared<ResultSet>(std::move(rows));
+    set->extendable_ = true;
+    return set;
+}
+
+const std::vector<uint32_t>& ResultSet::order(SortMode mode) const {
+    size_t m = static_cast<size_t>(mode);
+    if (m >= SORT_MODE_COUNT) m = 0;
+    std::call_once(order_once_[m], [&]() { orders_[m] = build_order(static_cast<SortMode>(m)); });
+    return orders_[m];
+}
+
+/* ties fall back to row index so every permutation is deterministic */
+std::vector<uint32_t> ResultSet::build_order(SortMode mode) const {
+    std::vector<uint32_t> order(rows_.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    auto by_key = [&](auto key_of) {
+        using Key = decltype(key_of(rows_[0]));
+        std::vector<Key> keys;
+        keys.reserve(rows_.size());
+        for (const auto& r : rows_) keys.push_back(key_of(r));
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            if (keys[a] != keys[b]) return keys[a] < keys[b];
+            return a < b;
+        });
+    };
+
+    switch (mode) {
+        case SortMode::InstallSize:
+            by_key([](const PackageRow& r) { return -r.install_size; });
+            break;
+        case SortMode::Date:
+            by_key([](const PackageRow& r) { return -r.build_date; });
+            break;
+        case SortMode::Votes:
+            by_key([](const PackageRow& r) { return -static_cast<int64_t>(r.aur_votes); });
+            break;
+        case SortMode::Name:
+        default: {
+            std::vector<uint64_t> keys;
+            keys.reserve(rows_.size());
+            for (const auto& r : rows_) keys.push_back(name_prefix_key(r.name));
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                if (keys[a] != keys[b]) return keys[a] < keys[b];
+                int c = rows_[a].name.compare(rows_[b].name);
+                if (c != 0) return c < 0;
+                return a < b;
+            });
+            break;
+        }
+    }
+    return order;
+}
+
+void PackageList::sort(SortMode mode, bool descending) {
+    if (!rows_) return;
+    order_ = &rows_->order(mode);
+    descending_ = descending;
+}
+
+}
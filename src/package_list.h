@@ -0,0 +1,73 @@
+#pragma once
+#include "package.h"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace pmt {
+
+enum class SortMode {
+    Name,
+    InstallSize,
+    Date,
+    Votes,
+};
+
+static constexpr size_t SORT_MODE_COUNT = 4;
+
+class ResultSet;
+using ResultSetPtr = std::shared_ptr<const ResultSet>;
+
+/* immutable rows plus one lazily built sort permutation per SortMode */
+class ResultSet {
+public:
+    explicit ResultSet(std::vector<PackageRow> rows) : rows_(std::move(rows)) {}
+
+    ResultSet(const ResultSet&) = delete;
+    ResultSet& operator=(const ResultSet&) = delete;
+
+    size_t size() const { return rows_.size(); }
+    bool empty() const { return rows_.empty(); }
+    const PackageRow& operator[](size_t i) const { return rows_[i]; }
+    const std::vector<PackageRow>& rows() const { return rows_; }
+
+    const std::vector<uint32_t>& order(SortMode mode) const;
+
+    static ResultSetPtr extend(ResultSetPtr prev, std::vector<PackageRow> more);
+
+private:
+    std::vector<PackageRow> rows_;
+    bool extendable_ = false;
+    mutable std::array<std::once_flag, SORT_MODE_COUNT> order_once_;
+    mutable std::array<std::vector<uint32_t>, SORT_MODE_COUNT> orders_;
+
+    std::vector<uint32_t> build_order(SortMode mode) const;
+};
+
+/* sorted view over a shared result set; descending walks the permutation backwards */
+class PackageList {
+public:
+    PackageList() = default;
+    explicit PackageList(ResultSetPtr rows) : rows_(std::move(rows)) {}
+    explicit PackageList(std::vector<PackageRow> rows)
+        : rows_(std::make_shared<const ResultSet>(std::move(rows))) {}
+
+    size_t size() const { return rows_ ? rows_->size() : 0; }
+    bool empty() const { return size() == 0; }
+    const PackageRow& operator[](size_t i) const {
+        if (!order_) return (*rows_)[i];
+        return (*rows_)[(*order_)[descending_ ? order_->size() - 1 - i : i]];
+    }
+    const ResultSetPtr& rows() const { return rows_; }
+
+    void sort(SortMode mode, bool descending);
+
+private:
+    ResultSetPtr rows_;
+    const std::vector<uint32_t>* order_ = nullptr;
+    bool descending_ = false;
+};
+
+}
@@ -1,6 +1,9 @@
 #include "pacman_conf.h"
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
 #include <sys/utsname.h>
 
 namespace pmt {
@@ -20,6 +23,8 @@ bool PacmanConfig::parse(const std::string& path) {
     std::string line;
     std::string current_section;
     RepoConfig* current_repo = nullptr;
+    /* every repo usually includes the same mirrorlist; read each file once */
+    std::unordered_map<std::string, std::vector<std::string>> includes;
 
     siglevel = (1 << 0) | (1 << 11);
 
@@ -54,9 +59,16 @@ bool PacmanConfig::parse(const std::string& path) {
             else if (key == "GPGDir") gpg_dir = value;
             else if (key == "Architecture") architecture = value;
             else if (key == "SigLevel") siglevel = parse_siglevel(value);
+            else if (key == "ParallelDownloads") parallel_downloads = std::max(1, atoi(value.c_str()));
         } else if (current_repo) {
             if (key == "Include") {
-                parse_mirrorlist(value, current_repo->servers);
+                auto it = includes.find(value);
+                if (it == includes.end()) {
+                    it = includes.emplace(value, std::vector<std::string>()).first;
+                    parse_mirrorlist(value, it->second);
+                }
+                current_repo->servers.insert(current_repo->servers.end(),
+                                             it->second.begin(), it->second.end());
             } else if (key == "Server") {
                 std::string url = value;
                 size_t pos;
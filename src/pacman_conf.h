@@ -17,6 +17,7 @@ struct PacmanConfig {
     std::string gpg_dir = "/etc/pacman.d/gnupg/";
     std::string architecture = "auto";
     int siglevel = 0;
+    int parallel_downloads = 1;
     std::vector<RepoConfig> repos;
 
     bool parse(const std::string& path = "/etc/pacman.conf");
@@ -0,0 +1,111 @@
+#include "perf.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <unistd.h>
+
+namespace pmt::perf {
+
+std::atomic<bool> active{false};
+
+namespace {
+
+struct Slot {
+    std::atomic<uint64_t> last_ns{0};
+    std::atomic<uint64_t> last_value{0};
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> total_ns{0};
+};
+
+Slot slots[METRIC_COUNT];
+
+const char* const NAMES[METRIC_COUNT] = {
+    "https_get", "parse_results", "alpm_search", "resolve", "ui_draw", "term_flush",
+};
+
+std::mutex trace_mutex;
+FILE* trace_fp = nullptr;
+bool trace_first = true;
+uint64_t trace_origin = 0;
+bool counters_on = false;
+std::atomic<bool> tracing{false};
+
+std::atomic<int> next_tid{1};
+
+int thread_id() {
+    thread_local int tid = next_tid.fetch_add(1);
+    return tid;
+}
+
+void update_active() {
+    tracing.store(trace_fp != nullptr, std::memory_order_relaxed);
+    active.store(counters_on || trace_fp, std::memory_order_relaxed);
+}
+
+}
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void set_enabled(bool on) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    counters_on = on;
+    update_active();
+}
+
+void record(Metric m, uint64_t start_ns, uint64_t end_ns, uint64_t value) {
+    Slot& s = slots[m];
+    uint64_t dur = end_ns - start_ns;
+    s.last_ns.store(dur, std::memory_order_relaxed);
+    s.last_value.store(value, std::memory_order_relaxed);
+    s.calls.fetch_add(1, std::memory_order_relaxed);
+    s.total_ns.fetch_add(dur, std::memory_order_relaxed);
+
+    if (!tracing.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!trace_fp || start_ns < trace_origin) return;
+    fprintf(trace_fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%llu}}",
+            trace_first ? "\n" : ",\n", NAMES[m], static_cast<int>(getpid()), thread_id(),
+            static_cast<double>(start_ns - trace_origin) / 1000.0, static_cast<double>(dur) / 1000.0,
+            static_cast<unsigned long long>(value));
+    trace_first = false;
+}
+
+Stat stat(Metric m) {
+    const Slot& s = slots[m];
+    Stat out;
+    out.last_ns = s.last_ns.load(std::memory_order_relaxed);
+    out.last_value = s.last_value.load(std::memory_order_relaxed);
+    out.calls = s.calls.load(std::memory_order_relaxed);
+    out.total_ns = s.total_ns.load(std::memory_order_relaxed);
+    return out;
+}
+
+const char* name(Metric m) {
+    return m < METRIC_COUNT ? NAMES[m] : "?";
+}
+
+bool start_trace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (trace_fp) return true;
+    trace_fp = fopen(path.c_str(), "w");
+    if (!trace_fp) return false;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace_fp);
+    trace_first = true;
+    trace_origin = now_ns();
+    update_active();
+    return true;
+}
+
+void stop_trace() {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!trace_fp) return;
+    fputs("\n]}\n", trace_fp);
+    fclose(trace_fp);
+    trace_fp = nullptr;
+    update_active();
+}
+
+}
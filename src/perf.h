@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace pmt::perf {
+
+enum Metric : uint8_t {
+    HttpsGet,
+    ParseResults,
+    AlpmSearch,
+    Resolve,
+    UiDraw,
+    TermFlush,
+    METRIC_COUNT,
+};
+
+struct Stat {
+    uint64_t last_ns = 0;
+    uint64_t last_value = 0;
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+};
+
+extern std::atomic<bool> active;
+
+/* a relaxed load, so scopes cost next to nothing while instrumentation is off */
+inline bool enabled() { return active.load(std::memory_order_relaxed); }
+
+void set_enabled(bool on);
+uint64_t now_ns();
+void record(Metric m, uint64_t start_ns, uint64_t end_ns, uint64_t value);
+Stat stat(Metric m);
+const char* name(Metric m);
+
+/* streams every scope as a Chrome trace event ("X" phase) to path until stop_trace() */
+bool start_trace(const std::string& path);
+void stop_trace();
+
+/* times the enclosing block; add() attaches a byte or item count to the sample */
+class Scope {
+public:
+    explicit Scope(Metric m) : metric_(m), start_(enabled() ? now_ns() : 0) {}
+    ~Scope() {
+        if (start_) record(metric_, start_, now_ns(), value_);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    void add(uint64_t v) { value_ += v; }
+
+private:
+    Metric metric_;
+    uint64_t start_;
+    uint64_t value_ = 0;
+};
+
+}
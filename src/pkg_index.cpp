@@ -0,0 +1,171 @@
+#include "pkg_index.h"
+#include <algorithm>
+#include <cstring>
+
+namespace pmt {
+
+static char lower_ascii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static void append_lower(std::string& out, const char* s) {
+    if (!s) return;
+    for (; *s; ++s) out += lower_ascii(*s);
+}
+
+/* snapshots every sync package into one lowercase text blob */
+void PackageIndex::load(alpm_handle_t* handle) {
+    clear();
+    if (!handle) return;
+
+    alpm_list_t* syncdbs = alpm_get_syncdbs(handle);
+    for (alpm_list_t* i = syncdbs; i; i = alpm_list_next(i)) {
+        alpm_db_t* db = static_cast<alpm_db_t*>(i->data);
+        uint32_t db_idx = static_cast<uint32_t>(db_names_.size());
+        db_names_.emplace_back(alpm_db_get_name(db));
+
+        for (alpm_list_t* j = alpm_db_get_pkgcache(db); j; j = alpm_list_next(j)) {
+            alpm_pkg_t* pkg = static_cast<alpm_pkg_t*>(j->data);
+            Entry e;
+            e.pkg = pkg;
+            e.db = db_idx;
+            e.text_off = static_cast<uint32_t>(text_.size());
+
+            append_lower(text_, alpm_pkg_get_name(pkg));
+            text_ += '\n';
+            append_lower(text_, alpm_pkg_get_desc(pkg));
+            for (alpm_list_t* p = alpm_pkg_get_provides(pkg); p; p = alpm_list_next(p)) {
+                auto* dep = static_cast<alpm_depend_t*>(p->data);
+                if (!dep || !dep->name) continue;
+                text_ += '\n';
+                append_lower(text_, dep->name);
+            }
+
+            e.text_len = static_cast<uint32_t>(text_.size()) - e.text_off;
+            text_ += '\0';
+            by_name_.emplace(alpm_pkg_get_name(pkg), static_cast<uint32_t>(entries_.size()));
+            entries_.push_back(e);
+        }
+    }
+}
+
+/* adds the trigram postings over the loaded snapshot */
+void PackageIndex::finish() {
+    build_trigrams();
+    built_ = true;
+}
+
+void PackageIndex::clear() {
+    built_ = false;
+    entries_.clear();
+    db_names_.clear();
+    text_.clear();
+    tri_offsets_.clear();
+    tri_ids_.clear();
+    by_name_.clear();
+    last_query_.clear();
+    last_hits_.clear();
+}
+
+/* exact name lookup; the first DB in pacman.conf order wins, like alpm_sync_get_new_version */
+uint32_t PackageIndex::find(std::string_view name) const {
+    auto it = by_name_.find(name);
+    return it == by_name_.end() ? npos : it->second;
+}
+
+uint32_t PackageIndex::trigram_bucket(const char* p) {
+    uint32_t v = static_cast<unsigned char>(p[0])
+               | static_cast<unsigned char>(p[1]) << 8
+               | static_cast<unsigned char>(p[2]) << 16;
+    return ((v * 2654435761u) >> 15) & (TRIGRAM_BUCKETS - 1);
+}
+
+/* two-pass counting fill: postings per bucket are sorted by entry id and deduplicated */
+void PackageIndex::build_trigrams() {
+    std::vector<uint32_t> counts(TRIGRAM_BUCKETS + 1, 0);
+    std::vector<uint32_t> last(TRIGRAM_BUCKETS, UINT32_MAX);
+
+    auto for_each_bucket = [&](auto&& fn) {
+        for (uint32_t id = 0; id < entries_.size(); ++id) {
+            const Entry& e = entries_[id];
+            const char* s = text_.data() + e.text_off;
+            for (uint32_t k = 0; k + 3 <= e.text_len; ++k) {
+                uint32_t b = trigram_bucket(s + k);
+                if (last[b] == id) continue;
+                last[b] = id;
+                fn(b, id);
+            }
+        }
+    };
+
+    for_each_bucket([&](uint32_t b, uint32_t) { counts[b + 1]++; });
+    for (uint32_t b = 0; b < TRIGRAM_BUCKETS; ++b)
+        counts[b + 1] += counts[b];
+
+    tri_offsets_ = counts;
+    tri_ids_.resize(counts[TRIGRAM_BUCKETS]);
+    std::fill(last.begin(), last.end(), UINT32_MAX);
+    for_each_bucket([&](uint32_t b, uint32_t id) { tri_ids_[counts[b]++] = id; });
+}
+
+/* intersects the two shortest posting lists of the needle's trigrams */
+std::vector<uint32_t> PackageIndex::trigram_candidates(const std::string& needle) const {
+    std::vector<std::pair<uint32_t, uint32_t>> lists;
+    for (size_t k = 0; k + 3 <= needle.size(); ++k) {
+        uint32_t b = trigram_bucket(needle.data() + k);
+        lists.emplace_back(tri_offsets_[b], tri_offsets_[b + 1]);
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+        return a.second - a.first < b.second - b.first;
+    });
+
+    const uint32_t* a_begin = tri_ids_.data() + lists[0].first;
+    const uint32_t* a_end = tri_ids_.data() + lists[0].second;
+    if (lists.size() == 1)
+        return std::vector<uint32_t>(a_begin, a_end);
+
+    std::vector<uint32_t> out;
+    std::set_intersection(a_begin, a_end,
+                          tri_ids_.data() + lists[1].first, tri_ids_.data() + lists[1].second,
+                          std::back_inserter(out));
+    return out;
+}
+
+bool PackageIndex::entry_matches(uint32_t id, const std::string& needle) const {
+    const Entry& e = entries_[id];
+    return memmem(text_.data() + e.text_off, e.text_len, needle.data(), needle.size()) != nullptr;
+}
+
+/* case-insensitive substring search; a query extending the previous one
+ * only rescans the previous hits */
+std::vector<uint32_t> PackageIndex::search(const std::string& query) {
+    std::string needle;
+    needle.reserve(query.size());
+    for (char c : query) needle += lower_ascii(c);
+
+    std::vector<uint32_t> hits;
+    if (needle.empty()) return hits;
+
+    bool refine = !last_query_.empty() && needle.find(last_query_) != std::string::npos;
+    if (refine) {
+        for (uint32_t id : last_hits_)
+            if (entry_matches(id, needle)) hits.push_back(id);
+    } else if (needle.size() >= 3) {
+        for (uint32_t id : trigram_candidates(needle))
+            if (entry_matches(id, needle)) hits.push_back(id);
+    } else {
+        for (uint32_t id = 0; id < entries_.size(); ++id)
+            if (entry_matches(id, needle)) hits.push_back(id);
+    }
+
+    last_query_ = std::move(needle);
+    last_hits_ = hits;
+    return hits;
+}
+
+/* queries with regex syntax keep alpm_db_search semantics */
+bool PackageIndex::needs_regex(const std::string& query) {
+    return query.find_first_of("*?[](){}|^$\\") != std::string::npos;
+}
+
+}
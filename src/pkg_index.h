@@ -0,0 +1,59 @@
+#pragma once
+#include <alpm.h>
+#include <string>
+#include <vector>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+namespace pmt {
+
+/* flat, trigram-indexed table of name/description/provides over all sync DBs */
+class PackageIndex {
+public:
+    /* load() is the only part that touches libalpm; finish() builds the postings from
+       the snapshot alone, so it can run without holding the alpm handle */
+    void load(alpm_handle_t* handle);
+    void finish();
+    void clear();
+    bool built() const { return built_; }
+    size_t size() const { return entries_.size(); }
+
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    std::vector<uint32_t> search(const std::string& query);
+    uint32_t find(std::string_view name) const;
+
+    alpm_pkg_t* pkg(uint32_t id) const { return entries_[id].pkg; }
+    const std::string& repo(uint32_t id) const { return db_names_[entries_[id].db]; }
+
+    static bool needs_regex(const std::string& query);
+
+private:
+    struct Entry {
+        alpm_pkg_t* pkg;
+        uint32_t db;
+        uint32_t text_off;
+        uint32_t text_len;
+    };
+
+    static constexpr uint32_t TRIGRAM_BUCKETS = 1u << 17;
+
+    bool built_ = false;
+    std::vector<Entry> entries_;
+    std::vector<std::string> db_names_;
+    std::string text_;
+    std::vector<uint32_t> tri_offsets_;
+    std::vector<uint32_t> tri_ids_;
+    std::unordered_map<std::string_view, uint32_t> by_name_;
+
+    std::string last_query_;
+    std::vector<uint32_t> last_hits_;
+
+    static uint32_t trigram_bucket(const char* p);
+    void build_trigrams();
+    std::vector<uint32_t> trigram_candidates(const std::string& needle) const;
+    bool entry_matches(uint32_t id, const std::string& needle) const;
+};
+
+}
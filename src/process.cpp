@@ -0,0 +1,254 @@
+#include "process.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pwd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+
+extern char** environ;
+
+namespace pmt {
+
+namespace {
+
+constexpr int EXIT_POLL_MS = 100;
+constexpr int KILL_GRACE_MS = 2000;
+
+/* PATH lookup happens before fork so the child only makes async-signal-safe calls */
+std::string find_executable(const std::string& name) {
+    if (name.find('/') != std::string::npos) return name;
+    const char* path = getenv("PATH");
+    std::string dirs = path ? path : "/usr/local/sbin:/usr/local/bin:/usr/bin:/bin";
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) end = dirs.size();
+        std::string dir = dirs.substr(start, end - start);
+        std::string candidate = (dir.empty() ? "." : dir) + "/" + name;
+        if (access(candidate.c_str(), X_OK) == 0) return candidate;
+        start = end + 1;
+    }
+    return "";
+}
+
+std::vector<std::string> merged_env(const std::vector<std::string>& extra) {
+    std::vector<std::string> env;
+    for (char** e = environ; *e; ++e) {
+        std::string entry = *e;
+        std::string key = entry.substr(0, entry.find('=') + 1);
+        bool overridden = false;
+        for (const auto& x : extra) {
+            if (x.compare(0, key.size(), key) == 0) {
+                overridden = true;
+                break;
+            }
+        }
+        if (!overridden) env.push_back(std::move(entry));
+    }
+    env.insert(env.end(), extra.begin(), extra.end());
+    return env;
+}
+
+std::vector<char*> c_strings(const std::vector<std::string>& v) {
+    std::vector<char*> out;
+    out.reserve(v.size() + 1);
+    for (const auto& s : v) out.push_back(const_cast<char*>(s.c_str()));
+    out.push_back(nullptr);
+    return out;
+}
+
+/* cuts output into lines; a bare \r restarts the line the way a terminal would,
+   so progress meters from git and curl collapse to their final state */
+class LineSplitter {
+public:
+    explicit LineSplitter(const LineSink& sink) : sink_(sink) {}
+
+    void feed(const char* data, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            char c = data[i];
+            if (c == '\n') {
+                emit();
+                cr_ = false;
+            } else if (c == '\r') {
+                cr_ = true;
+            } else {
+                if (cr_) {
+                    line_.clear();
+                    cr_ = false;
+                }
+                line_ += c;
+            }
+        }
+    }
+
+    void finish() {
+        if (!line_.empty()) emit();
+    }
+
+private:
+    const LineSink& sink_;
+    std::string line_;
+    bool cr_ = false;
+
+    void emit() {
+        if (sink_) sink_(line_);
+        line_.clear();
+    }
+};
+
+}
+
+ProcessResult run_process(const std::vector<std::string>& argv, const LineSink& sink,
+                          const ProcessOptions& opts) {
+    using clock = std::chrono::steady_clock;
+    ProcessResult result;
+    if (argv.empty()) return result;
+
+    std::string exe = find_executable(argv[0]);
+    if (exe.empty()) {
+        if (sink) sink(argv[0] + ": command not found");
+        result.status = 127;
+        return result;
+    }
+
+    std::vector<std::string> env = merged_env(opts.env);
+    std::vector<char*> c_argv = c_strings(argv);
+    std::vector<char*> c_env = c_strings(env);
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) return result;
+    int devnull = open("/dev/null", O_RDWR | O_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        if (devnull >= 0) close(devnull);
+        return result;
+    }
+
+    if (pid == 0) {
+        setpgid(0, 0);
+        sigset_t all;
+        sigemptyset(&all);
+        sigprocmask(SIG_SETMASK, &all, nullptr);
+        struct sigaction dfl{};
+        dfl.sa_handler = SIG_DFL;
+        sigaction(SIGPIPE, &dfl, nullptr);
+        sigaction(SIGWINCH, &dfl, nullptr);
+
+        if (devnull >= 0) dup2(devnull, STDIN_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(opts.discard_stderr && devnull >= 0 ? devnull : fds[1], STDERR_FILENO);
+        if (!opts.cwd.empty() && chdir(opts.cwd.c_str()) != 0) _exit(126);
+        execve(exe.c_str(), c_argv.data(), c_env.data());
+        _exit(127);
+    }
+
+    setpgid(pid, pid);
+    close(fds[1]);
+    if (devnull >= 0) close(devnull);
+
+    auto start = clock::now();
+    clock::time_point kill_at;
+    bool terminating = false;
+    bool killed = false;
+    bool pipe_open = true;
+    int wstatus = 0;
+    LineSplitter lines(sink);
+    char buf[8192];
+
+    for (;;) {
+        int wait_ms = EXIT_POLL_MS;
+        auto now = clock::now();
+        if (opts.timeout_ms > 0 && !terminating) {
+            auto left = opts.timeout_ms - std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+            wait_ms = static_cast<int>(std::max<long long>(0, std::min<long long>(wait_ms, left)));
+        }
+
+        struct pollfd pfd{pipe_open ? fds[0] : -1, POLLIN, 0};
+        int r = poll(&pfd, 1, wait_ms);
+        if (r > 0 && pipe_open) {
+            ssize_t n = read(fds[0], buf, sizeof(buf));
+            if (n > 0) lines.feed(buf, static_cast<size_t>(n));
+            else if (n == 0 || errno != EINTR) pipe_open = false;
+        }
+
+        pid_t w = waitpid(pid, &wstatus, WNOHANG);
+        if (w == pid || (w < 0 && errno == ECHILD)) break;
+
+        now = clock::now();
+        if (!terminating) {
+            if (opts.cancel && opts.cancel->load()) result.cancelled = true;
+            else if (opts.timeout_ms > 0 && now - start >= std::chrono::milliseconds(opts.timeout_ms))
+                result.timed_out = true;
+            if (result.cancelled || result.timed_out) {
+                kill(-pid, SIGTERM);
+                terminating = true;
+                kill_at = now + std::chrono::milliseconds(KILL_GRACE_MS);
+            }
+        } else if (!killed && now >= kill_at) {
+            kill(-pid, SIGKILL);
+            killed = true;
+        }
+    }
+
+    /* whatever the child wrote before exiting; a daemon it left behind may still
+       hold the pipe open, so stop at the first empty read instead of waiting for EOF */
+    if (pipe_open) {
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        for (;;) {
+            ssize_t n = read(fds[0], buf, sizeof(buf));
+            if (n > 0) lines.feed(buf, static_cast<size_t>(n));
+            else if (n < 0 && errno == EINTR) continue;
+            else break;
+        }
+    }
+    lines.finish();
+    close(fds[0]);
+
+    if (WIFEXITED(wstatus)) result.status = WEXITSTATUS(wstatus);
+    return result;
+}
+
+bool lookup_user(const std::string& name, UserInfo& out) {
+    long size = sysconf(_SC_GETPW_R_SIZE_MAX);
+    std::vector<char> buf(size > 0 ? static_cast<size_t>(size) : 16384);
+    struct passwd pw{};
+    struct passwd* found = nullptr;
+    if (getpwnam_r(name.c_str(), &pw, buf.data(), buf.size(), &found) != 0 || !found)
+        return false;
+    out.uid = pw.pw_uid;
+    out.gid = pw.pw_gid;
+    out.home = pw.pw_dir ? pw.pw_dir : "";
+    return true;
+}
+
+bool chown_tree(const std::string& path, const UserInfo& user, bool recursive) {
+    namespace fs = std::filesystem;
+    bool ok = lchown(path.c_str(), user.uid, user.gid) == 0;
+    if (!recursive) return ok;
+
+    std::error_code ec;
+    if (!fs::is_directory(fs::symlink_status(path, ec))) return ok;
+    for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        if (lchown(it->path().c_str(), user.uid, user.gid) != 0) ok = false;
+    }
+    return ok && !ec;
+}
+
+bool chown_to_sudo_user(const std::string& path, bool recursive) {
+    const char* sudo_user = getenv("SUDO_USER");
+    if (geteuid() != 0 || !sudo_user || !sudo_user[0]) return true;
+    UserInfo user;
+    if (!lookup_user(sudo_user, user)) return false;
+    return chown_tree(path, user, recursive);
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <sys/types.h>
+
+namespace pmt {
+
+using LineSink = std::function<void(const std::string&)>;
+
+struct ProcessOptions {
+    std::string cwd;
+    std::vector<std::string> env;               /* NAME=value entries added to the environment */
+    int timeout_ms = 0;                         /* 0 waits forever */
+    const std::atomic<bool>* cancel = nullptr;  /* polled while the child runs */
+    bool discard_stderr = false;
+};
+
+struct ProcessResult {
+    int status = -1;            /* exit code; -1 if it could not start or died on a signal */
+    bool timed_out = false;
+    bool cancelled = false;
+
+    bool ok() const { return status == 0; }
+};
+
+/* fork/execs argv without a shell, streaming stdout+stderr to sink one line at a time;
+   on timeout or cancel the child's whole process group is terminated */
+ProcessResult run_process(const std::vector<std::string>& argv, const LineSink& sink,
+                          const ProcessOptions& opts = {});
+
+/* uid/gid/home of a passwd entry via getpwnam_r */
+struct UserInfo {
+    uid_t uid = 0;
+    gid_t gid = 0;
+    std::string home;
+};
+bool lookup_user(const std::string& name, UserInfo& out);
+
+/* lchown over path and, when recursive, everything below it */
+bool chown_tree(const std::string& path, const UserInfo& user, bool recursive = true);
+
+/* hands path to $SUDO_USER when running as root under sudo; a no-op otherwise */
+bool chown_to_sudo_user(const std::string& path, bool recursive = true);
+
+}
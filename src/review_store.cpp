@@ -0,0 +1,224 @@
+#include "review_store.h"
+#include "process.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <openssl/evp.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pmt {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/* regular files only; O_NOFOLLOW so a path swapped for a link can't be read through */
+bool read_file(const std::string& path, std::string& out) {
+    out.clear();
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) out.append(buf, static_cast<size_t>(n));
+    close(fd);
+    return n == 0;
+}
+
+/* tracked paths come from git; never let one escape the checkout or the store */
+bool safe_relative(const std::string& path) {
+    if (path.empty() || path[0] == '/') return false;
+    std::filesystem::path p(path);
+    for (const auto& part : p)
+        if (part == "..") return false;
+    return true;
+}
+
+/* every directory between root and the entry must be a real directory, not a link */
+bool real_parents(const std::string& root, const std::string& path) {
+    fs::path cur(root);
+    fs::path rel(path);
+    for (auto it = rel.begin(); it != rel.end();) {
+        cur /= *it;
+        if (++it == rel.end()) break;
+        std::error_code ec;
+        if (!fs::is_directory(fs::symlink_status(cur, ec))) return false;
+    }
+    return true;
+}
+
+enum class Entry { Missing, Regular, Symlink };
+
+/* tracked entries are never followed: a symlink yields its target text, a regular
+   file its bytes; a checkout is attacker-controlled and pmt may be running as root */
+Entry read_entry(const std::string& root, const std::string& path, std::string& out) {
+    out.clear();
+    if (!safe_relative(path) || !real_parents(root, path)) return Entry::Missing;
+    fs::path p = fs::path(root) / path;
+    std::error_code ec;
+    if (fs::is_symlink(fs::symlink_status(p, ec))) {
+        fs::path target = fs::read_symlink(p, ec);
+        if (ec) return Entry::Missing;
+        out = target.string();
+        return Entry::Symlink;
+    }
+    return read_file(p.string(), out) ? Entry::Regular : Entry::Missing;
+}
+
+}
+
+std::string ReviewStore::sha256_hex(const std::string& data) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    if (!EVP_Digest(data.data(), data.size(), md, &len, EVP_sha256(), nullptr)) return "";
+    static const char hex[] = "0123456789abcdef";
+    std::string out(len * 2, '0');
+    for (unsigned int i = 0; i < len; ++i) {
+        out[i * 2] = hex[md[i] >> 4];
+        out[i * 2 + 1] = hex[md[i] & 0xf];
+    }
+    return out;
+}
+
+std::string ReviewStore::manifest_path(const std::string& base) const {
+    return dir_ + "/" + base + "/.manifest";
+}
+
+/* hashes every tracked file of a checkout; unreadable files hash as empty so
+   their disappearance still changes the digest, and links hash their target
+   under a separate prefix so they can't collide with a file of the same text */
+ReviewStore::Snapshot ReviewStore::scan(const std::string& checkout, std::vector<std::string> tracked) {
+    Snapshot snap;
+    std::sort(tracked.begin(), tracked.end());
+    tracked.erase(std::unique(tracked.begin(), tracked.end()), tracked.end());
+
+    std::string manifest;
+    for (auto& path : tracked) {
+        if (!safe_relative(path)) continue;
+        std::string content;
+        Entry kind = read_entry(checkout, path, content);
+        std::string digest = sha256_hex(content);
+        if (kind == Entry::Symlink) digest = "link:" + digest;
+        File f{std::move(path), std::move(digest)};
+        manifest += f.digest + "  " + f.path + "\n";
+        snap.files.push_back(std::move(f));
+    }
+    if (!snap.files.empty()) snap.digest = sha256_hex(manifest);
+    return snap;
+}
+
+/* first line is the tree digest, then one "sha256  path" line per file */
+std::vector<ReviewStore::File> ReviewStore::load_manifest(const std::string& base,
+                                                         std::string* digest) const {
+    std::vector<File> files;
+    std::ifstream f(manifest_path(base));
+    if (!f) return files;
+
+    std::string line;
+    if (!std::getline(f, line)) return files;
+    if (digest) *digest = line;
+    while (std::getline(f, line)) {
+        size_t sep = line.find("  ");
+        if (sep == std::string::npos) continue;
+        files.push_back({line.substr(sep + 2), line.substr(0, sep)});
+    }
+    return files;
+}
+
+bool ReviewStore::is_reviewed(const std::string& base, const Snapshot& snap) const {
+    if (snap.empty()) return false;
+    std::ifstream f(manifest_path(base));
+    std::string digest;
+    return f && std::getline(f, digest) && digest == snap.digest;
+}
+
+/* added or modified paths, PKGBUILD first; a store from before manifests holds
+   only PKGBUILD, so everything else counts as new */
+std::vector<std::string> ReviewStore::changed_files(const std::string& base,
+                                                    const Snapshot& snap) const {
+    std::vector<File> old = load_manifest(base, nullptr);
+    std::vector<std::string> changed;
+    for (const auto& f : snap.files) {
+        auto it = std::find_if(old.begin(), old.end(),
+                               [&](const File& o) { return o.path == f.path; });
+        if (it != old.end() && it->digest == f.digest) continue;
+        if (it == old.end() && f.path == "PKGBUILD") {
+            std::string content;
+            if (read_file(dir_ + "/" + base + "/PKGBUILD", content) && sha256_hex(content) == f.digest)
+                continue;
+        }
+        changed.push_back(f.path);
+    }
+    std::stable_partition(changed.begin(), changed.end(),
+                          [](const std::string& p) { return p == "PKGBUILD"; });
+    return changed;
+}
+
+/* what the review screen shows for an entry: file contents, or the link itself */
+std::string ReviewStore::display_content(const std::string& root, const std::string& path) {
+    std::string content;
+    if (read_entry(root, path, content) == Entry::Symlink) return "symlink -> " + content + "\n";
+    return content;
+}
+
+std::string ReviewStore::reviewed_content(const std::string& base, const std::string& path) const {
+    return display_content(dir_ + "/" + base, path);
+}
+
+/* copies the approved files in, drops ones the tree no longer has, then writes the manifest last
+   so an interrupted record never looks reviewed; links are recreated as links, never copied through */
+bool ReviewStore::record(const std::string& base, const std::string& checkout, const Snapshot& snap) {
+    if (snap.empty()) return false;
+
+    std::string dest = dir_ + "/" + base;
+    std::error_code ec;
+    fs::create_directories(dest, ec);
+    if (ec) return false;
+    std::vector<File> previous = load_manifest(base, nullptr);
+    fs::remove(manifest_path(base), ec);
+
+    for (const auto& old : previous) {
+        bool kept = std::any_of(snap.files.begin(), snap.files.end(),
+                                [&](const File& f) { return f.path == old.path; });
+        if (!kept && safe_relative(old.path)) fs::remove(dest + "/" + old.path, ec);
+    }
+
+    for (const auto& f : snap.files) {
+        fs::path target = fs::path(dest) / f.path;
+        fs::create_directories(target.parent_path(), ec);
+        if (!real_parents(dest, f.path)) continue;
+        fs::remove(target, ec);
+
+        std::string content;
+        Entry kind = read_entry(checkout, f.path, content);
+        if (kind == Entry::Symlink) {
+            fs::create_symlink(content, target, ec);
+        } else if (kind == Entry::Regular) {
+            std::ofstream out(target, std::ios::binary | std::ios::trunc);
+            out << content;
+        }
+    }
+
+    std::string tmp = manifest_path(base) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+        out << snap.digest << "\n";
+        for (const auto& f : snap.files) out << f.digest << "  " << f.path << "\n";
+        if (!out) return false;
+    }
+    fs::rename(tmp, manifest_path(base), ec);
+    if (ec) return false;
+
+    chown_to_sudo_user(dir_, false);
+    chown_to_sudo_user(dest);
+    return true;
+}
+
+}
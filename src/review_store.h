@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace pmt {
+
+/* per-pkgbase record of the AUR tree the user last approved: a manifest of the
+   tracked files with their SHA-256, one digest over that manifest, and copies of
+   the approved files so a later review only diffs what actually changed */
+class ReviewStore {
+public:
+    struct File {
+        std::string path;
+        std::string digest;
+    };
+
+    /* files sorted by path; digest covers every path and content hash */
+    struct Snapshot {
+        std::string digest;
+        std::vector<File> files;
+        bool empty() const { return files.empty(); }
+    };
+
+    explicit ReviewStore(std::string dir) : dir_(std::move(dir)) {}
+
+    static Snapshot scan(const std::string& checkout, std::vector<std::string> tracked);
+    static std::string display_content(const std::string& root, const std::string& path);
+
+    bool is_reviewed(const std::string& base, const Snapshot& snap) const;
+    std::vector<std::string> changed_files(const std::string& base, const Snapshot& snap) const;
+    std::string reviewed_content(const std::string& base, const std::string& path) const;
+    bool record(const std::string& base, const std::string& checkout, const Snapshot& snap);
+
+private:
+    std::string dir_;
+
+    std::string manifest_path(const std::string& base) const;
+    std::vector<File> load_manifest(const std::string& base, std::string* digest) const;
+    static std::string sha256_hex(const std::string& data);
+};
+
+}
@@ -0,0 +1,83 @@
+#include "satisfier_index.h"
+
+namespace pmt {
+
+/* names point into package data owned by libalpm, so the index must be dropped
+   whenever the DBs' package caches may have been reloaded */
+void SatisfierIndex::build(const std::vector<alpm_db_t*>& dbs) {
+    clear();
+    for (alpm_db_t* db : dbs) {
+        for (alpm_list_t* i = alpm_db_get_pkgcache(db); i; i = alpm_list_next(i)) {
+            alpm_pkg_t* pkg = static_cast<alpm_pkg_t*>(i->data);
+            by_name_[alpm_pkg_get_name(pkg)].push_back({pkg, alpm_pkg_get_version(pkg), false, true});
+
+            for (alpm_list_t* p = alpm_pkg_get_provides(pkg); p; p = alpm_list_next(p)) {
+                auto* prov = static_cast<alpm_depend_t*>(p->data);
+                bool versioned = prov->mod == ALPM_DEP_MOD_EQ && prov->version;
+                by_name_[prov->name].push_back({pkg, prov->version, true, versioned});
+            }
+        }
+    }
+    built_ = true;
+}
+
+void SatisfierIndex::clear() {
+    by_name_.clear();
+    memo_.clear();
+    built_ = false;
+}
+
+bool SatisfierIndex::version_matches(const char* have, alpm_depmod_t mod, const std::string& want) {
+    if (mod == ALPM_DEP_MOD_ANY) return true;
+    int cmp = alpm_pkg_vercmp(have, want.c_str());
+    switch (mod) {
+        case ALPM_DEP_MOD_EQ: return cmp == 0;
+        case ALPM_DEP_MOD_GE: return cmp >= 0;
+        case ALPM_DEP_MOD_LE: return cmp <= 0;
+        case ALPM_DEP_MOD_GT: return cmp > 0;
+        case ALPM_DEP_MOD_LT: return cmp < 0;
+        default: return true;
+    }
+}
+
+/* a real package of that name wins over providers, and an unversioned provide
+   only satisfies an unversioned dependency, matching libalpm */
+alpm_pkg_t* SatisfierIndex::find(const std::string& depstring) {
+    auto memo = memo_.find(depstring);
+    if (memo != memo_.end()) return memo->second;
+
+    size_t op = depstring.find_first_of("<>=");
+    std::string_view name(depstring.data(), op == std::string::npos ? depstring.size() : op);
+    alpm_depmod_t mod = ALPM_DEP_MOD_ANY;
+    std::string want;
+    if (op != std::string::npos) {
+        char c0 = depstring[op];
+        bool eq_next = op + 1 < depstring.size() && depstring[op + 1] == '=';
+        if (c0 == '=') mod = ALPM_DEP_MOD_EQ;
+        else if (c0 == '>') mod = eq_next ? ALPM_DEP_MOD_GE : ALPM_DEP_MOD_GT;
+        else mod = eq_next ? ALPM_DEP_MOD_LE : ALPM_DEP_MOD_LT;
+        want = depstring.substr(op + ((c0 != '=' && eq_next) ? 2 : 1));
+    }
+
+    alpm_pkg_t* found = nullptr;
+    auto it = by_name_.find(name);
+    if (it != by_name_.end()) {
+        for (const auto& c : it->second) {
+            if (!c.provide && version_matches(c.version, mod, want)) { found = c.pkg; break; }
+        }
+        if (!found) {
+            for (const auto& c : it->second) {
+                if (!c.provide) continue;
+                if (mod == ALPM_DEP_MOD_ANY || (c.versioned && version_matches(c.version, mod, want))) {
+                    found = c.pkg;
+                    break;
+                }
+            }
+        }
+    }
+
+    memo_.emplace(depstring, found);
+    return found;
+}
+
+}
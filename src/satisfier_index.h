@@ -0,0 +1,34 @@
+#pragma once
+#include <alpm.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+namespace pmt {
+
+/* name/provides hash over a set of DBs answering depstrings like alpm_find_dbs_satisfier */
+class SatisfierIndex {
+public:
+    void build(const std::vector<alpm_db_t*>& dbs);
+    void clear();
+    bool built() const { return built_; }
+
+    alpm_pkg_t* find(const std::string& depstring);
+
+private:
+    struct Candidate {
+        alpm_pkg_t* pkg;
+        const char* version;
+        bool provide;
+        bool versioned;
+    };
+
+    bool built_ = false;
+    std::unordered_map<std::string_view, std::vector<Candidate>> by_name_;
+    std::unordered_map<std::string, alpm_pkg_t*> memo_;
+
+    static bool version_matches(const char* have, alpm_depmod_t mod, const std::string& want);
+};
+
+}
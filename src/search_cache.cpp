@@ -0,0 +1,85 @@
+#include "search_cache.h"
+#include <algorithm>
+
+namespace pmt {
+
+/* the AUR matches case-insensitively, so entries are keyed by the folded query */
+std::string SearchCache::fold(const std::string& s) {
+    std::string out = s;
+    for (char& c : out)
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    return out;
+}
+
+SearchCache::Results SearchCache::lookup(const std::string& query) {
+    std::string key = fold(query);
+    auto now = Clock::now();
+    auto ttl = std::chrono::seconds(TTL_SECONDS);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto hit = index_.find(key);
+    if (hit != index_.end()) {
+        if (now - hit->second->fetched_at < ttl) {
+            lru_.splice(lru_.begin(), lru_, hit->second);
+            return hit->second->results;
+        }
+        erase_locked(hit->second);
+    }
+
+    /* LIKE wildcards in the query rule out plain substring refinement */
+    if (key.find_first_of("%_") != std::string::npos) return nullptr;
+
+    auto best = lru_.end();
+    for (auto it = lru_.begin(); it != lru_.end(); ++it) {
+        if (now - it->fetched_at >= ttl) continue;
+        if (key.find(it->key) == std::string::npos) continue;
+        if (best == lru_.end() || it->key.size() > best->key.size()) best = it;
+    }
+    if (best == lru_.end()) return nullptr;
+
+    auto refined = std::make_shared<std::vector<PackageInfo>>();
+    for (const auto& p : *best->results) {
+        if (fold(p.name).find(key) != std::string::npos ||
+            fold(p.description).find(key) != std::string::npos)
+            refined->push_back(p);
+    }
+    Clock::time_point fetched_at = best->fetched_at;
+    lru_.splice(lru_.begin(), lru_, best);
+    insert_locked(key, refined, fetched_at);
+    return refined;
+}
+
+void SearchCache::put(const std::string& query, std::vector<PackageInfo> results) {
+    auto shared = std::make_shared<const std::vector<PackageInfo>>(std::move(results));
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert_locked(fold(query), std::move(shared), Clock::now());
+}
+
+void SearchCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    rows_ = 0;
+}
+
+/* refined sets inherit their source's fetch time so they expire together */
+void SearchCache::insert_locked(std::string key, Results results, Clock::time_point fetched_at) {
+    if (results->size() > MAX_ROWS) return;
+    auto old = index_.find(key);
+    if (old != index_.end()) erase_locked(old->second);
+
+    rows_ += results->size();
+    lru_.push_front({key, std::move(results), fetched_at});
+    index_[std::move(key)] = lru_.begin();
+
+    while (lru_.size() > MAX_QUERIES || rows_ > MAX_ROWS)
+        erase_locked(std::prev(lru_.end()));
+}
+
+void SearchCache::erase_locked(std::list<Entry>::iterator it) {
+    rows_ -= it->results->size();
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "package.h"
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pmt {
+
+/* in-memory LRU of complete AUR search result sets; a query containing a cached
+   query is answered by filtering that set, since every name/description that
+   matches the longer string also matches the shorter one */
+class SearchCache {
+public:
+    using Results = std::shared_ptr<const std::vector<PackageInfo>>;
+
+    static constexpr size_t MAX_QUERIES = 32;
+    static constexpr size_t MAX_ROWS = 20000;
+    static constexpr int TTL_SECONDS = 5 * 60;
+
+    Results lookup(const std::string& query);
+    void put(const std::string& query, std::vector<PackageInfo> results);
+    void clear();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string key;
+        Results results;
+        Clock::time_point fetched_at;
+    };
+
+    std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t rows_ = 0;
+
+    void insert_locked(std::string key, Results results, Clock::time_point fetched_at);
+    void erase_locked(std::list<Entry>::iterator it);
+    static std::string fold(const std::string& s);
+};
+
+}
@@ -1,13 +1,23 @@
 #include "terminal.h"
+#include "perf.h"
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <cerrno>
+#include <clocale>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <algorithm>
 
 namespace pmt {
 
 Terminal::Terminal() {
-    buffer_.reserve(4096);
+    /* wcwidth() only knows wide glyphs under the user's UTF-8 locale */
+    setlocale(LC_CTYPE, "");
+    out_.reserve(4096);
     update_size();
+    resize_grids();
 }
 
 Terminal::~Terminal() {
@@ -36,38 +46,329 @@ void Terminal::exit_raw_mode() {
     raw_mode_ = false;
 }
 
-void Terminal::enter_alt_screen() { buffer_ += "\033[?1049h"; }
-void Terminal::exit_alt_screen()  { buffer_ += "\033[?1049l"; }
-void Terminal::hide_cursor()      { buffer_ += "\033[?25l"; }
-void Terminal::show_cursor()      { buffer_ += "\033[?25h"; }
-void Terminal::clear()            { buffer_ += "\033[2J\033[H"; }
+void Terminal::enter_alt_screen() {
+    control_ += "\033[?1049h";
+    alt_screen_ = true;
+    front_valid_ = false;
+}
+
+void Terminal::exit_alt_screen() {
+    control_ += "\033[0m\033[?1049l";
+    alt_screen_ = false;
+    out_attr_ = Attr{};
+}
+
+void Terminal::hide_cursor() { cursor_visible_ = false; }
+void Terminal::show_cursor() { cursor_visible_ = true; }
+
+void Terminal::clear() {
+    std::fill(back_.begin(), back_.end(), Cell{});
+    cur_row_ = 0;
+    cur_col_ = 0;
+}
+
+void Terminal::invalidate() { front_valid_ = false; }
+
+/* scrolls rows top..bottom up by n with a DECSTBM region and shifts the front grid to
+   match, so the next flush only sends the rows that scrolled in */
+void Terminal::scroll_up(int top, int bottom, int n) {
+    if (!alt_screen_ || !front_valid_) return;
+    top = std::max(top, 0);
+    bottom = std::min(bottom, rows_ - 1);
+    if (n <= 0 || n > bottom - top) return;
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\033[?25l\033[0m\033[%d;%dr\033[%d;1H", top + 1, bottom + 1, bottom + 1);
+    control_ += buf;
+    control_.append(static_cast<size_t>(n), '\n');
+    control_ += "\033[r";
+    out_cursor_visible_ = false;
+    out_attr_ = Attr{};
+    out_row_ = -1;
+
+    Cell* f = front_.data();
+    std::move(f + static_cast<size_t>(top + n) * cols_, f + static_cast<size_t>(bottom + 1) * cols_,
+              f + static_cast<size_t>(top) * cols_);
+    std::fill(f + static_cast<size_t>(bottom + 1 - n) * cols_, f + static_cast<size_t>(bottom + 1) * cols_,
+              Cell{});
+}
 
 void Terminal::move_to(int row, int col) {
-    char buf[24];
-    int n = snprintf(buf, sizeof(buf), "\033[%d;%dH", row + 1, col + 1);
-    buffer_.append(buf, n);
+    cur_row_ = row;
+    cur_col_ = col;
 }
 
-void Terminal::write(const std::string& s) { buffer_ += s; }
-void Terminal::write(const char* s)        { buffer_ += s; }
+void Terminal::write(const std::string& s) { put_bytes(s.data(), s.size()); }
+void Terminal::write(const char* s)        { put_bytes(s, strlen(s)); }
 
 void Terminal::write_truncated(const std::string& s, int max_width) {
     if (max_width <= 0) return;
     int len = static_cast<int>(s.size());
     if (len <= max_width) {
-        buffer_ += s;
+        put_bytes(s.data(), s.size());
     } else if (max_width <= 3) {
-        buffer_.append(s, 0, max_width);
+        put_bytes(s.data(), max_width);
     } else {
-        buffer_.append(s, 0, max_width - 3);
-        buffer_ += "...";
+        put_bytes(s.data(), max_width - 3);
+        put_bytes("...", 3);
     }
 }
 
+namespace {
+
+/* U+FFFD, packed like every other glyph: first UTF-8 byte lowest */
+constexpr uint32_t REPLACEMENT_GLYPH = 0xEF | (0xBF << 8) | (0xBD << 16);
+
+}
+
+/* interprets SGR escapes and UTF-8 glyphs written by the UI into the back grid; text
+   shown for review must match the file, so tabs expand to 8-column stops counted from
+   where this write began, other control bytes show as reversed ^X, and zero-width or
+   C1 code points show as U+FFFD instead of vanishing */
+void Terminal::put_bytes(const char* s, size_t len) {
+    int origin = cur_col_;
+    size_t i = 0;
+    while (i < len) {
+        unsigned char b = static_cast<unsigned char>(s[i]);
+        if (b == 0x1b) {
+            i += parse_escape(s + i, len - i);
+            continue;
+        }
+        if (b == '\t') {
+            ++i;
+            int stop = origin + ((cur_col_ - origin) / 8 + 1) * 8;
+            while (cur_col_ < stop) put_cell(' ', 1);
+            continue;
+        }
+        if (b < 0x20 || b == 0x7f) {
+            ++i;
+            Attr saved = cur_attr_;
+            cur_attr_.flags ^= ATTR_REVERSE;
+            put_cell('^', 1);
+            put_cell(b ^ 0x40, 1);
+            cur_attr_ = saved;
+            continue;
+        }
+
+        size_t n = 1;
+        uint32_t cp = b;
+        if ((b & 0xE0) == 0xC0) { n = 2; cp = b & 0x1F; }
+        else if ((b & 0xF0) == 0xE0) { n = 3; cp = b & 0x0F; }
+        else if ((b & 0xF8) == 0xF0) { n = 4; cp = b & 0x07; }
+        if (i + n > len) break;
+
+        bool valid = b < 0x80 || n > 1;
+        uint32_t glyph = b;
+        for (size_t k = 1; k < n && valid; ++k) {
+            unsigned char c = static_cast<unsigned char>(s[i + k]);
+            if ((c & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            cp = (cp << 6) | (c & 0x3F);
+            glyph |= static_cast<uint32_t>(c) << (8 * k);
+        }
+        if (!valid) {
+            ++i;
+            put_cell(REPLACEMENT_GLYPH, 1);
+            continue;
+        }
+        i += n;
+
+        int width = 1;
+        if (cp >= 0x80) {
+            int w = wcwidth(static_cast<wchar_t>(cp));
+            if (cp < 0xA0 || w == 0) glyph = REPLACEMENT_GLYPH;
+            else if (w == 2) width = 2;
+        }
+        put_cell(glyph, width);
+    }
+}
+
+/* a wide glyph that would wrap becomes a blank; overwriting either half of a wide
+   glyph blanks the other half, as a real terminal does */
+void Terminal::put_cell(uint32_t glyph, int width) {
+    if (width == 2 && cur_col_ + 1 >= cols_) {
+        glyph = ' ';
+        width = 1;
+    }
+    if (cur_row_ >= 0 && cur_row_ < rows_ && cur_col_ >= 0 && cur_col_ < cols_) {
+        Cell* row = back_.data() + static_cast<size_t>(cur_row_) * cols_;
+        auto split = [&](int c) {
+            if (row[c].width == 0 && c > 0) row[c - 1] = Cell{' ', row[c - 1].attr, 1};
+            else if (row[c].width == 2 && c + 1 < cols_) row[c + 1] = Cell{' ', row[c + 1].attr, 1};
+        };
+        split(cur_col_);
+        if (width == 2) split(cur_col_ + 1);
+
+        row[cur_col_] = Cell{glyph, cur_attr_, static_cast<uint8_t>(width)};
+        if (width == 2) row[cur_col_ + 1] = Cell{0, cur_attr_, 0};
+    }
+    cur_col_ += width;
+}
+
+size_t Terminal::parse_escape(const char* s, size_t len) {
+    if (len < 2) return len;
+    if (s[1] != '[') return 2;
+
+    size_t j = 2;
+    while (j < len && !(s[j] >= 0x40 && s[j] <= 0x7E)) ++j;
+    if (j >= len) return len;
+    if (s[j] == 'm') apply_sgr(s + 2, j - 2);
+    return j + 1;
+}
+
+void Terminal::apply_sgr(const char* params, size_t len) {
+    std::vector<int> codes;
+    int value = 0;
+    bool have = false;
+    for (size_t i = 0; i <= len; ++i) {
+        if (i == len || params[i] == ';') {
+            codes.push_back(have ? value : 0);
+            value = 0;
+            have = false;
+        } else if (params[i] >= '0' && params[i] <= '9') {
+            value = value * 10 + (params[i] - '0');
+            have = true;
+        }
+    }
+
+    for (size_t i = 0; i < codes.size(); ++i) {
+        int c = codes[i];
+        if (c == 0) cur_attr_ = Attr{};
+        else if (c == 1) cur_attr_.flags |= ATTR_BOLD;
+        else if (c == 2) cur_attr_.flags |= ATTR_DIM;
+        else if (c == 7) cur_attr_.flags |= ATTR_REVERSE;
+        else if (c == 22) cur_attr_.flags &= ~(ATTR_BOLD | ATTR_DIM);
+        else if (c == 27) cur_attr_.flags &= ~ATTR_REVERSE;
+        else if (c >= 30 && c <= 37) cur_attr_.fg = (3u << 24) | static_cast<uint32_t>(c - 30);
+        else if (c >= 90 && c <= 97) cur_attr_.fg = (3u << 24) | static_cast<uint32_t>(c - 90 + 8);
+        else if (c == 39) cur_attr_.fg = 0;
+        else if (c == 38 && i + 2 < codes.size() && codes[i + 1] == 5) {
+            cur_attr_.fg = (2u << 24) | static_cast<uint32_t>(codes[i + 2] & 0xFF);
+            i += 2;
+        } else if (c == 38 && i + 4 < codes.size() && codes[i + 1] == 2) {
+            cur_attr_.fg = (1u << 24)
+                         | static_cast<uint32_t>(codes[i + 2] & 0xFF) << 16
+                         | static_cast<uint32_t>(codes[i + 3] & 0xFF) << 8
+                         | static_cast<uint32_t>(codes[i + 4] & 0xFF);
+            i += 4;
+        }
+    }
+}
+
+void Terminal::emit_move(int row, int col) {
+    if (out_row_ == row && out_col_ == col) return;
+    char buf[24];
+    int n = snprintf(buf, sizeof(buf), "\033[%d;%dH", row + 1, col + 1);
+    out_.append(buf, n);
+    out_row_ = row;
+    out_col_ = col;
+}
+
+void Terminal::emit_attr(const Attr& attr) {
+    if (attr == out_attr_) return;
+    out_ += "\033[0";
+    if (attr.flags & ATTR_BOLD) out_ += ";1";
+    if (attr.flags & ATTR_DIM) out_ += ";2";
+    if (attr.flags & ATTR_REVERSE) out_ += ";7";
+
+    char buf[24];
+    int n = 0;
+    uint32_t kind = attr.fg >> 24;
+    uint32_t v = attr.fg & 0xFFFFFF;
+    if (kind == 3) n = snprintf(buf, sizeof(buf), ";%u", v < 8 ? 30 + v : 90 + v - 8);
+    else if (kind == 2) n = snprintf(buf, sizeof(buf), ";38;5;%u", v);
+    else if (kind == 1) n = snprintf(buf, sizeof(buf), ";38;2;%u;%u;%u", v >> 16, (v >> 8) & 0xFF, v & 0xFF);
+    if (n > 0) out_.append(buf, n);
+
+    out_ += 'm';
+    out_attr_ = attr;
+}
+
+void Terminal::emit_cell(int row, int col) {
+    size_t i = static_cast<size_t>(row) * cols_ + col;
+    const Cell& cell = back_[i];
+    emit_attr(cell.attr);
+    for (uint32_t g = cell.glyph; g; g >>= 8)
+        out_ += static_cast<char>(g & 0xFF);
+    front_[i] = cell;
+
+    /* never trust the terminal's idea of a wide glyph's advance; move explicitly next */
+    out_col_ = col + 1;
+    if (cell.width != 1 || out_col_ >= cols_) out_row_ = -1;
+}
+
+/* sends control sequences, then the changed cells with minimal cursor moves */
 void Terminal::flush() {
-    if (!buffer_.empty()) {
-        ::write(STDOUT_FILENO, buffer_.data(), buffer_.size());
-        buffer_.clear();
+    perf::Scope timer(perf::TermFlush);
+    out_ += control_;
+    control_.clear();
+
+    if (alt_screen_) {
+        if (!front_valid_) {
+            out_ += "\033[0m\033[2J";
+            std::fill(front_.begin(), front_.end(), Cell{});
+            out_attr_ = Attr{};
+            out_row_ = -1;
+            front_valid_ = true;
+        }
+
+        for (int r = 0; r < rows_; ++r) {
+            const Cell* b = back_.data() + static_cast<size_t>(r) * cols_;
+            const Cell* f = front_.data() + static_cast<size_t>(r) * cols_;
+            for (int c = 0; c < cols_; ++c) {
+                if (b[c] == f[c]) continue;
+                /* the right half of a wide glyph is painted with its left half */
+                if (b[c].width == 0) {
+                    front_[static_cast<size_t>(r) * cols_ + c] = b[c];
+                    continue;
+                }
+
+                if (out_cursor_visible_) {
+                    out_ += "\033[?25l";
+                    out_cursor_visible_ = false;
+                }
+
+                bool bridged = false;
+                if (out_row_ == r && c > out_col_ && c - out_col_ <= 4) {
+                    bridged = true;
+                    for (int k = out_col_; k < c; ++k)
+                        if (b[k].attr != out_attr_ || b[k].width != 1) { bridged = false; break; }
+                }
+                if (bridged) {
+                    for (int k = out_col_; k < c; ++k) emit_cell(r, k);
+                } else {
+                    emit_move(r, c);
+                }
+                emit_cell(r, c);
+            }
+        }
+
+        if (cursor_visible_) {
+            emit_move(std::clamp(cur_row_, 0, rows_ - 1), std::clamp(cur_col_, 0, cols_ - 1));
+        }
+    }
+
+    if (cursor_visible_ != out_cursor_visible_) {
+        out_ += cursor_visible_ ? "\033[?25h" : "\033[?25l";
+        out_cursor_visible_ = cursor_visible_;
+    }
+
+    timer.add(out_.size());
+    write_out(out_);
+    out_.clear();
+}
+
+void Terminal::write_out(const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = ::write(STDOUT_FILENO, data.data() + off, data.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        off += static_cast<size_t>(n);
     }
 }
 
@@ -97,10 +398,20 @@ const char* Terminal::reset()         { return "\033[0m"; }
 
 void Terminal::update_size() {
     struct winsize ws{};
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) {
-        rows_ = ws.ws_row;
-        cols_ = ws.ws_col;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        if (ws.ws_row != rows_ || ws.ws_col != cols_) {
+            rows_ = ws.ws_row;
+            cols_ = ws.ws_col;
+            resize_grids();
+        }
     }
 }
 
+void Terminal::resize_grids() {
+    size_t n = static_cast<size_t>(rows_) * cols_;
+    back_.assign(n, Cell{});
+    front_.assign(n, Cell{});
+    front_valid_ = false;
+}
+
 }
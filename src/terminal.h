@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <termios.h>
 
 namespace pmt {
 
+/* double-buffered cell grid; flush() emits only the cells that changed */
 class Terminal {
 public:
     Terminal();
@@ -26,6 +28,8 @@ public:
     void write(const char* s);
     void write_truncated(const std::string& s, int max_width);
     void flush();
+    void invalidate();
+    void scroll_up(int top, int bottom, int n);
 
     enum Color {
         Black = 0, Red, Green, Yellow, Blue, Magenta, Cyan, White,
@@ -46,11 +50,60 @@ public:
     void update_size();
 
 private:
+    struct Attr {
+        uint32_t fg = 0;
+        uint8_t flags = 0;
+        bool operator==(const Attr& o) const { return fg == o.fg && flags == o.flags; }
+        bool operator!=(const Attr& o) const { return !(*this == o); }
+    };
+
+    /* width 2 is a wide glyph whose right half is the next cell, held as a width-0
+       continuation with no glyph of its own */
+    struct Cell {
+        uint32_t glyph = ' ';
+        Attr attr;
+        uint8_t width = 1;
+        bool operator==(const Cell& o) const {
+            return glyph == o.glyph && attr == o.attr && width == o.width;
+        }
+        bool operator!=(const Cell& o) const { return !(*this == o); }
+    };
+
+    static constexpr uint8_t ATTR_BOLD = 1;
+    static constexpr uint8_t ATTR_DIM = 2;
+    static constexpr uint8_t ATTR_REVERSE = 4;
+
     struct termios orig_termios_{};
     bool raw_mode_ = false;
     int rows_ = 24;
     int cols_ = 80;
-    std::string buffer_;
+
+    std::vector<Cell> back_;
+    std::vector<Cell> front_;
+    bool front_valid_ = false;
+    bool alt_screen_ = false;
+
+    int cur_row_ = 0;
+    int cur_col_ = 0;
+    Attr cur_attr_;
+    bool cursor_visible_ = true;
+
+    std::string control_;
+    std::string out_;
+    int out_row_ = -1;
+    int out_col_ = -1;
+    Attr out_attr_;
+    bool out_cursor_visible_ = true;
+
+    void resize_grids();
+    void put_bytes(const char* s, size_t len);
+    void put_cell(uint32_t glyph, int width);
+    size_t parse_escape(const char* s, size_t len);
+    void apply_sgr(const char* params, size_t len);
+    void emit_move(int row, int col);
+    void emit_attr(const Attr& attr);
+    void emit_cell(int row, int col);
+    void write_out(const std::string& data);
 };
 
 }
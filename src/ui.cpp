@@ -1,15 +1,12 @@
 #include "ui.h"
 #include "input.h"
+#include "diff.h"
+#include "perf.h"
 #include <algorithm>
 #include <climits>
 
 namespace {
 
-struct DiffLine {
-    char tag;
-    std::string text;
-};
-
 std::vector<std::string> split_lines(const std::string& content) {
     std::vector<std::string> lines;
     std::string line;
@@ -25,38 +22,29 @@ std::vector<std::string> split_lines(const std::string& content) {
     return lines;
 }
 
-/* LCS-based diff between old and new file contents */
-std::vector<DiffLine> compute_diff(const std::vector<std::string>& old_lines,
-                                   const std::vector<std::string>& new_lines) {
-    int m = static_cast<int>(old_lines.size());
-    int n = static_cast<int>(new_lines.size());
-
-    std::vector<std::vector<int>> dp(m + 1, std::vector<int>(n + 1, 0));
-    for (int i = 1; i <= m; ++i) {
-        for (int j = 1; j <= n; ++j) {
-            if (old_lines[i - 1] == new_lines[j - 1])
-                dp[i][j] = dp[i - 1][j - 1] + 1;
-            else
-                dp[i][j] = std::max(dp[i - 1][j], dp[i][j - 1]);
-        }
-    }
-
-    std::vector<DiffLine> result;
-    int i = m, j = n;
-    while (i > 0 || j > 0) {
-        if (i > 0 && j > 0 && old_lines[i - 1] == new_lines[j - 1]) {
-            result.push_back({' ', old_lines[i - 1]});
-            --i; --j;
-        } else if (j > 0 && (i == 0 || dp[i][j - 1] >= dp[i - 1][j])) {
-            result.push_back({'+', new_lines[j - 1]});
-            --j;
-        } else {
-            result.push_back({'-', old_lines[i - 1]});
-            --i;
+/* latest sample of each instrumented path, for the status-bar overlay */
+std::string perf_summary() {
+    using namespace pmt;
+    static constexpr struct { perf::Metric metric; const char* label; bool bytes; } items[] = {
+        {perf::UiDraw, "draw", false},      {perf::TermFlush, "flush", true},
+        {perf::AlpmSearch, "search", false}, {perf::HttpsGet, "https", true},
+        {perf::ParseResults, "parse", true}, {perf::Resolve, "resolve", false},
+    };
+    std::string out = "perf";
+    for (const auto& item : items) {
+        perf::Stat s = perf::stat(item.metric);
+        out += "  ";
+        out += item.label;
+        if (s.calls == 0) {
+            out += " -";
+            continue;
         }
+        char buf[32];
+        snprintf(buf, sizeof(buf), " %.2fms", static_cast<double>(s.last_ns) / 1e6);
+        out += buf;
+        if (item.bytes) out += "/" + format_size(static_cast<int64_t>(s.last_value));
     }
-    std::reverse(result.begin(), result.end());
-    return result;
+    return out;
 }
 
 }
@@ -94,21 +82,25 @@ void UI::ensure_visible() {
 }
 
 /* renders full TUI frame */
-void UI::draw(const std::vector<PackageInfo>& packages) {
-    term_.clear();
-    term_.hide_cursor();
-    draw_search_bar();
-    draw_borders();
-    draw_package_list(packages);
-    draw_detail_pane(packages);
-    draw_status_bar(packages);
+void UI::draw(const PackageList& packages) {
+    {
+        perf::Scope timer(perf::UiDraw);
+        term_.clear();
+        term_.hide_cursor();
+        draw_search_bar();
+        draw_borders();
+        draw_package_list(packages);
+        draw_detail_pane(packages);
+        draw_status_bar(packages);
+
+        if (focus == Focus::SearchBar) {
+            term_.show_cursor();
+            term_.move_to(0, 13 + search_cursor);
+        }
 
-    if (focus == Focus::SearchBar) {
-        term_.show_cursor();
-        term_.move_to(0, 13 + search_cursor);
+        term_.flush();
     }
-
-    term_.flush();
+    prefetch_details(packages);
 }
 
 void UI::draw_search_bar() {
@@ -172,7 +164,7 @@ void UI::draw_borders() {
     term_.write(Terminal::reset());
 }
 
-void UI::draw_package_list(const std::vector<PackageInfo>& packages) {
+void UI::draw_package_list(const PackageList& packages) {
     int lw = list_width();
     int h = content_height();
     int start_row = 2;
@@ -235,22 +227,54 @@ void UI::draw_package_list(const std::vector<PackageInfo>& packages) {
     }
 }
 
-void UI::rebuild_detail_lines(const std::vector<PackageInfo>& packages) {
-    detail_lines_.clear();
-    detail_cache_idx_ = selected;
-
-    if (selected < 0 || selected >= static_cast<int>(packages.size())) return;
-
-    const auto& pkg = packages[selected];
-    int dw = detail_width();
-    if (dw < 10) return;
-
-    int label_width = std::min(16, dw / 3);
+/* label and value columns of the detail pane at width dw */
+void UI::detail_columns(int dw, int& label_width, int& label_col, int& value_width) {
+    label_width = std::min(16, dw / 3);
     if (label_width < 4) label_width = 4;
-    int label_col = label_width + 3;
+    label_col = label_width + 3;
     if (label_col >= dw) label_col = dw - 1;
-    int value_width = dw - label_col;
+    value_width = dw - label_col;
     if (value_width < 1) value_width = 1;
+}
+
+/* cached block for packages[idx]; rows are identified by address within a live result set */
+UI::DetailBlock* UI::detail_block(const PackageList& packages, int idx, int value_width) {
+    if (idx < 0 || idx >= static_cast<int>(packages.size())) return nullptr;
+    const ResultSet* set = packages.rows().get();
+    const PackageRow* row = &packages[idx];
+
+    for (auto it = detail_blocks_.begin(); it != detail_blocks_.end(); ++it) {
+        if (it->row != row || it->set != set) continue;
+        /* a freed set's address can be reused by the next one */
+        if (it->set_ref.expired()) break;
+        detail_blocks_.splice(detail_blocks_.begin(), detail_blocks_, it);
+        DetailBlock& block = detail_blocks_.front();
+        if (block.value_width != value_width) layout_detail_block(block, value_width);
+        return &block;
+    }
+
+    detail_blocks_.remove_if([](const DetailBlock& b) { return b.set_ref.expired(); });
+    if (detail_blocks_.size() >= DETAIL_CACHE_SIZE) detail_blocks_.pop_back();
+
+    detail_blocks_.emplace_front();
+    DetailBlock& block = detail_blocks_.front();
+    block.set = set;
+    block.set_ref = packages.rows();
+    block.row = row;
+    build_detail_fields(block);
+    layout_detail_block(block, value_width);
+    return &block;
+}
+
+void UI::build_detail_fields(DetailBlock& block) {
+    const PackageRow& row = *block.row;
+
+    PackageInfo loaded;
+    const PackageInfo* pkg = row.details.get();
+    if (!pkg) {
+        if (detail_loader) loaded = detail_loader(row);
+        pkg = &loaded;
+    }
 
     auto join = [](const std::vector<std::string>& v) {
         std::string r;
@@ -261,51 +285,67 @@ void UI::rebuild_detail_lines(const std::vector<PackageInfo>& packages) {
         return r;
     };
 
-    auto add_field = [&](const char* label, const std::string& value) {
-        if (static_cast<int>(value.size()) <= value_width) {
-            detail_lines_.push_back(std::string(label) + "|" + value);
-        } else {
-            detail_lines_.push_back(std::string(label) + "|" + value.substr(0, value_width));
-            int pos = value_width;
-            while (pos < static_cast<int>(value.size())) {
-                int chunk = std::min(value_width, static_cast<int>(value.size()) - pos);
-                detail_lines_.push_back("|" + value.substr(pos, chunk));
-                pos += chunk;
-            }
-        }
+    auto add_field = [&](const char* label, std::string value) {
+        block.fields.push_back({label, std::move(value), 0});
     };
 
-    add_field("Name", pkg.name);
-    add_field("Version", pkg.version);
-    if (pkg.installed && !pkg.installed_version.empty() && pkg.installed_version != pkg.version)
-        add_field("Installed", pkg.installed_version);
-    add_field("Repository", pkg.repo);
-    add_field("Description", pkg.description);
-    if (!pkg.url.empty())         add_field("URL", pkg.url);
-    if (!pkg.arch.empty())        add_field("Architecture", pkg.arch);
-    if (!pkg.licenses.empty())    add_field("Licenses", join(pkg.licenses));
-    if (!pkg.groups.empty())      add_field("Groups", join(pkg.groups));
-    if (!pkg.depends.empty())     add_field("Depends On", join(pkg.depends));
-    if (!pkg.optdepends.empty())  add_field("Optional Deps", join(pkg.optdepends));
-    if (!pkg.makedepends.empty()) add_field("Make Deps", join(pkg.makedepends));
-    if (!pkg.provides.empty())    add_field("Provides", join(pkg.provides));
-    if (!pkg.conflicts.empty())   add_field("Conflicts", join(pkg.conflicts));
-    if (pkg.download_size > 0)    add_field("Download Size", format_size(pkg.download_size));
-    if (pkg.install_size > 0)     add_field("Installed Size", format_size(pkg.install_size));
-    if (pkg.build_date > 0)       add_field("Build Date", format_date(pkg.build_date));
-    if (pkg.install_date > 0)     add_field("Install Date", format_date(pkg.install_date));
-    if (!pkg.packager.empty())    add_field("Packager", pkg.packager);
-
-    if (pkg.source == PackageSource::AUR) {
-        add_field("AUR Votes", std::to_string(pkg.aur_votes));
-        if (!pkg.aur_maintainer.empty())
-            add_field("Maintainer", pkg.aur_maintainer);
-        if (pkg.aur_out_of_date)
+    add_field("Name", row.name);
+    add_field("Version", row.version);
+    if (row.installed && !row.installed_version.empty() && row.installed_version != row.version)
+        add_field("Installed", row.installed_version);
+    add_field("Repository", row.repo);
+    add_field("Description", pkg->description);
+    if (!pkg->url.empty())         add_field("URL", pkg->url);
+    if (!pkg->arch.empty())        add_field("Architecture", pkg->arch);
+    if (!pkg->licenses.empty())    add_field("Licenses", join(pkg->licenses));
+    if (!pkg->groups.empty())      add_field("Groups", join(pkg->groups));
+    if (!pkg->depends.empty())     add_field("Depends On", join(pkg->depends));
+    if (!pkg->optdepends.empty())  add_field("Optional Deps", join(pkg->optdepends));
+    if (!pkg->makedepends.empty()) add_field("Make Deps", join(pkg->makedepends));
+    if (!pkg->provides.empty())    add_field("Provides", join(pkg->provides));
+    if (!pkg->conflicts.empty())   add_field("Conflicts", join(pkg->conflicts));
+    if (row.download_size > 0)     add_field("Download Size", format_size(row.download_size));
+    if (row.install_size > 0)      add_field("Installed Size", format_size(row.install_size));
+    if (row.build_date > 0)        add_field("Build Date", format_date(row.build_date));
+    if (row.install_date > 0)      add_field("Install Date", format_date(row.install_date));
+    if (!pkg->packager.empty())    add_field("Packager", pkg->packager);
+
+    if (row.source == PackageSource::AUR) {
+        add_field("AUR Votes", std::to_string(row.aur_votes));
+        if (!pkg->aur_maintainer.empty())
+            add_field("Maintainer", pkg->aur_maintainer);
+        if (row.aur_out_of_date)
             add_field("Status", "Out of date!");
     }
 }
 
-void UI::draw_detail_pane(const std::vector<PackageInfo>& packages) {
+/* wrapping is fixed-width, so each field's line count follows from its length alone */
+void UI::layout_detail_block(DetailBlock& block, int value_width) {
+    int line = 0;
+    for (auto& f : block.fields) {
+        f.first_line = line;
+        int len = static_cast<int>(f.value.size());
+        line += len <= value_width ? 1 : (len + value_width - 1) / value_width;
+    }
+    block.value_width = value_width;
+    block.total_lines = line;
+}
+
+/* load the rows around the selection after the frame is out, so stepping through the list hits the cache */
+void UI::prefetch_details(const PackageList& packages) {
+    if (!show_detail_pane()) return;
+    int dw = detail_width();
+    if (dw < 10) return;
+    int label_width, label_col, value_width;
+    detail_columns(dw, label_width, label_col, value_width);
+
+    for (int idx : {selected + 1, selected - 1})
+        detail_block(packages, idx, value_width);
+    /* keep the selected block most recent */
+    detail_block(packages, selected, value_width);
+}
+
+void UI::draw_detail_pane(const PackageList& packages) {
     if (!show_detail_pane()) return;
     int lw = list_width() + 1;
     int dw = detail_width();
@@ -322,24 +362,28 @@ void UI::draw_detail_pane(const std::vector<PackageInfo>& packages) {
 
     if (dw < 10) return;
 
-    if (selected != detail_cache_idx_)
-        rebuild_detail_lines(packages);
+    int label_width, label_col, value_width;
+    detail_columns(dw, label_width, label_col, value_width);
 
-    int label_width = std::min(16, dw / 3);
-    if (label_width < 4) label_width = 4;
-    int label_col = label_width + 3;
-    if (label_col >= dw) label_col = dw - 1;
+    const DetailBlock* block = detail_block(packages, selected, value_width);
+    const auto& fields = block->fields;
+    int total_lines = block->total_lines;
+
+    /* only the visible window is sliced out of the field values */
+    auto field = std::upper_bound(fields.begin(), fields.end(), detail_scroll,
+        [](int line, const DetailField& f) { return line < f.first_line; });
+    if (field != fields.begin()) --field;
 
-    int total_lines = static_cast<int>(detail_lines_.size());
     for (int i = 0; i < h && (detail_scroll + i) < total_lines; ++i) {
         int row = start_row + i;
-        const std::string& line = detail_lines_[detail_scroll + i];
+        int line = detail_scroll + i;
+        while (std::next(field) != fields.end() && std::next(field)->first_line <= line) ++field;
+        size_t offset = static_cast<size_t>(line - field->first_line) * value_width;
 
         term_.move_to(row, lw);
 
-        size_t sep = line.find('|');
-        if (sep != std::string::npos && sep > 0) {
-            std::string padded_label = line.substr(0, sep);
+        if (offset == 0) {
+            std::string padded_label = field->label;
             while (static_cast<int>(padded_label.size()) < label_width)
                 padded_label += ' ';
             if (static_cast<int>(padded_label.size()) > label_width)
@@ -353,13 +397,11 @@ void UI::draw_detail_pane(const std::vector<PackageInfo>& packages) {
 
             int label_used = 1 + label_width + 2;
             int remaining = dw - label_used;
-            if (remaining > 0) {
-                std::string value = line.substr(sep + 1);
-                term_.write_truncated(value, remaining);
-            }
-        } else if (sep == 0) {
+            if (remaining > 0)
+                term_.write_truncated(field->value.substr(0, value_width), remaining);
+        } else {
             term_.move_to(row, lw + label_col);
-            term_.write_truncated(line.substr(1), dw - label_col);
+            term_.write_truncated(field->value.substr(offset, value_width), dw - label_col);
         }
         term_.write(Terminal::reset());
     }
@@ -375,7 +417,7 @@ void UI::draw_detail_pane(const std::vector<PackageInfo>& packages) {
     }
 }
 
-void UI::draw_status_bar(const std::vector<PackageInfo>& packages) {
+void UI::draw_status_bar(const PackageList& packages) {
     int w = term_.cols();
     int row = term_.rows() - 1;
     term_.move_to(row, 0);
@@ -398,6 +440,10 @@ void UI::draw_status_bar(const std::vector<PackageInfo>& packages) {
             snprintf(pct, sizeof(pct), "%3d%%", static_cast<int>(progress.fraction * 100));
             term_.write(pct);
         }
+    } else if (perf_overlay) {
+        term_.write(" ");
+        term_.write(accent_fg());
+        term_.write_truncated(perf_summary(), w - 2);
     } else if (!status_message.empty()) {
         term_.write(" ");
         term_.write(accent_fg());
@@ -676,8 +722,37 @@ void UI::draw_message(const std::string& title, const std::string& msg) {
     }
 }
 
+/* renders the last height lines of log at row top; when the same log only grew since
+   the previous frame, the region is scrolled so just the new lines are sent */
+void UI::draw_log_tail(const LogBuffer& log, int top, int height) {
+    int w = term_.cols();
+    uint64_t total = log.total();
+    uint64_t start = total > static_cast<uint64_t>(height) ? total - height : 0;
+    start = std::max(start, log.first());
+
+    if (&log == tail_log_ && top == tail_top_ && height == tail_height_ &&
+        start > tail_start_ && start - tail_start_ < static_cast<uint64_t>(height)) {
+        term_.scroll_up(top, top + height - 1, static_cast<int>(start - tail_start_));
+    }
+    tail_log_ = &log;
+    tail_start_ = start;
+    tail_top_ = top;
+    tail_height_ = height;
+
+    for (int i = 0; i < height; ++i) {
+        uint64_t idx = start + i;
+        term_.move_to(top + i, 0);
+        if (idx < total) {
+            term_.write(" ");
+            term_.write(Terminal::dim());
+            term_.write_truncated(log.at(idx), w - 2);
+            term_.write(Terminal::reset());
+        }
+    }
+}
+
 /* full-screen auto-scrolling build log with elapsed timer */
-void UI::draw_build_log(const std::string& title, const std::vector<std::string>& log_lines,
+void UI::draw_build_log(const std::string& title, const LogBuffer& log,
                         bool finished, int elapsed_secs) {
     int w = term_.cols();
     int h = term_.rows();
@@ -699,19 +774,7 @@ void UI::draw_build_log(const std::string& title, const std::vector<std::string>
 
     int log_height = h - 4;
     if (log_height < 1) log_height = 1;
-    int total = static_cast<int>(log_lines.size());
-    int start = std::max(0, total - log_height);
-
-    for (int i = 0; i < log_height; ++i) {
-        int idx = start + i;
-        term_.move_to(2 + i, 0);
-        if (idx < total) {
-            term_.write(" ");
-            term_.write(Terminal::dim());
-            term_.write_truncated(log_lines[idx], w - 2);
-            term_.write(Terminal::reset());
-        }
-    }
+    draw_log_tail(log, 2, log_height);
 
     term_.move_to(h - 2, 0);
     term_.write(Terminal::dim());
@@ -752,7 +815,8 @@ void UI::draw_build_log(const std::string& title, const std::vector<std::string>
     term_.write(Terminal::reset());
 
     char lcount[32];
-    int lclen = snprintf(lcount, sizeof(lcount), "%d lines", total);
+    int lclen = snprintf(lcount, sizeof(lcount), "%llu lines",
+                         static_cast<unsigned long long>(log.total()));
     int lcount_x = w - lclen - 2;
     if (lcount_x > 30) {
         term_.move_to(h - 1, lcount_x);
@@ -764,6 +828,130 @@ void UI::draw_build_log(const std::string& title, const std::vector<std::string>
     term_.flush();
 }
 
+/* status line per job above the tail of the focused job's log */
+void UI::draw_job_log(const std::string& title, const std::vector<JobLine>& jobs, int focused,
+                      const LogBuffer& log, bool finished, int elapsed_secs) {
+    static const char* spin[] = {
+        "\u280b", "\u2819", "\u2839", "\u2838",
+        "\u283c", "\u2834", "\u2826", "\u2827",
+        "\u2807", "\u280f"
+    };
+
+    int w = term_.cols();
+    int h = term_.rows();
+    int njobs = static_cast<int>(jobs.size());
+
+    term_.clear();
+    term_.hide_cursor();
+
+    term_.move_to(0, 0);
+    term_.write(Terminal::bold());
+    term_.write(accent_fg());
+    term_.write(" ");
+    term_.write_truncated(title, w - 2);
+    term_.write(Terminal::reset());
+
+    term_.move_to(1, 0);
+    term_.write(Terminal::dim());
+    for (int i = 0; i < w - 1; ++i) term_.write("\u2500");
+    term_.write(Terminal::reset());
+
+    int status_rows = std::min(njobs, std::max(1, (h - 6) / 3));
+    int status_start = 0;
+    if (focused >= status_rows) status_start = focused - status_rows + 1;
+
+    int done = 0;
+    for (const auto& j : jobs)
+        if (j.state == JobLine::Done || j.state == JobLine::Failed) done++;
+
+    for (int i = 0; i < status_rows; ++i) {
+        int idx = status_start + i;
+        if (idx >= njobs) break;
+        const auto& j = jobs[idx];
+        term_.move_to(2 + i, 0);
+        term_.write(idx == focused ? accent_fg() : Terminal::dim());
+        term_.write(idx == focused ? "\u25b8" : " ");
+        term_.write(Terminal::reset());
+        switch (j.state) {
+            case JobLine::Queued:
+                term_.write(Terminal::dim());
+                term_.write("\u00b7");
+                break;
+            case JobLine::Running:
+                term_.write(accent_fg());
+                term_.write(spin[(elapsed_secs + idx) % 10]);
+                break;
+            case JobLine::Done:
+                term_.write(color_fg(Terminal::Green));
+                term_.write("\u2714");
+                break;
+            case JobLine::Failed:
+                term_.write(color_fg(Terminal::Red));
+                term_.write("\u2718");
+                break;
+        }
+        term_.write(Terminal::reset());
+        term_.write(" ");
+        if (idx == focused) term_.write(Terminal::bold());
+        std::string line = j.name;
+        if (!j.detail.empty()) line += "  " + j.detail;
+        term_.write_truncated(line, w - 4);
+        term_.write(Terminal::reset());
+    }
+
+    int sep_row = 2 + status_rows;
+    term_.move_to(sep_row, 0);
+    term_.write(Terminal::dim());
+    for (int i = 0; i < w - 1; ++i) term_.write("\u2500");
+    term_.write(Terminal::reset());
+
+    int log_height = h - 3 - sep_row;
+    if (log_height < 1) log_height = 1;
+    draw_log_tail(log, sep_row + 1, log_height);
+
+    term_.move_to(h - 2, 0);
+    term_.write(Terminal::dim());
+    for (int i = 0; i < w - 1; ++i) term_.write("\u2500");
+    term_.write(Terminal::reset());
+
+    term_.move_to(h - 1, 0);
+    term_.write(" ");
+    if (!finished) {
+        term_.write(accent_fg());
+        term_.write(spin[elapsed_secs % 10]);
+    } else {
+        term_.write(color_fg(Terminal::Green));
+        term_.write("\u2714");
+    }
+    term_.write(Terminal::reset());
+
+    char progress[64];
+    snprintf(progress, sizeof(progress), " %d/%d done ", done, njobs);
+    term_.write(progress);
+
+    int mins = elapsed_secs / 60;
+    int secs = elapsed_secs % 60;
+    char elapsed[32];
+    if (mins > 0)
+        snprintf(elapsed, sizeof(elapsed), "[%dm %02ds]", mins, secs);
+    else
+        snprintf(elapsed, sizeof(elapsed), "[%ds]", secs);
+    term_.write(Terminal::dim());
+    term_.write(elapsed);
+    term_.write(Terminal::reset());
+
+    const char* hint = finished ? "Tab/\u2191\u2193 switch log" : "Tab/\u2191\u2193 switch log  ^C cancel";
+    int hint_x = w - (finished ? 20 : 30);
+    if (hint_x > 34 && (njobs > 1 || !finished)) {
+        term_.move_to(h - 1, hint_x);
+        term_.write(Terminal::dim());
+        term_.write(hint);
+        term_.write(Terminal::reset());
+    }
+
+    term_.flush();
+}
+
 /* scrollable PKGBUILD viewer with diff toggle */
 bool UI::draw_pkgbuild_review(const std::string& pkg_name, const std::string& content,
                               const std::string& old_content) {
@@ -1,8 +1,12 @@
 #pragma once
 #include "terminal.h"
-#include "package.h"
+#include "package_list.h"
+#include "log_buffer.h"
 #include <string>
 #include <vector>
+#include <functional>
+#include <list>
+#include <memory>
 
 namespace pmt {
 
@@ -12,24 +16,25 @@ enum class Focus {
     DetailPane,
 };
 
-enum class SortMode {
-    Name,
-    InstallSize,
-    Date,
-    Votes,
-};
-
 struct ProgressInfo {
     std::string label;
     double fraction = 0.0;
     bool active = false;
 };
 
+/* one row of the multiplexed job view */
+struct JobLine {
+    enum State { Queued, Running, Done, Failed };
+    std::string name;
+    State state = Queued;
+    std::string detail;
+};
+
 class UI {
 public:
     explicit UI(Terminal& term);
 
-    void draw(const std::vector<PackageInfo>& packages);
+    void draw(const PackageList& packages);
 
     Focus focus = Focus::PackageList;
     int selected = 0;
@@ -46,6 +51,8 @@ public:
     std::string accent_code;
     SortMode sort_mode = SortMode::Name;
     bool sort_descending = false;
+    bool perf_overlay = false;
+    std::function<PackageInfo(const PackageRow&)> detail_loader;
 
     int list_width() const;
     int detail_width() const;
@@ -56,22 +63,51 @@ public:
     bool draw_confirm_dialog(const std::string& title, const std::vector<std::string>& lines);
     void draw_message(const std::string& title, const std::string& msg);
     int draw_selection_dialog(const std::string& title, const std::vector<std::string>& options);
-    void draw_build_log(const std::string& title, const std::vector<std::string>& log_lines,
+    void draw_build_log(const std::string& title, const LogBuffer& log,
                         bool finished, int elapsed_secs);
+    void draw_job_log(const std::string& title, const std::vector<JobLine>& jobs, int focused,
+                      const LogBuffer& log, bool finished, int elapsed_secs);
     bool draw_pkgbuild_review(const std::string& pkg_name, const std::string& content,
                               const std::string& old_content = "");
 
 private:
     Terminal& term_;
 
-    int detail_cache_idx_ = -1;
-    std::vector<std::string> detail_lines_;
-    void rebuild_detail_lines(const std::vector<PackageInfo>& packages);
+    static constexpr size_t DETAIL_CACHE_SIZE = 16;
+
+    struct DetailField {
+        std::string label;
+        std::string value;
+        int first_line = 0;
+    };
+
+    /* laid-out detail text for one row; lines are sliced from the fields on demand */
+    struct DetailBlock {
+        const ResultSet* set = nullptr;
+        std::weak_ptr<const ResultSet> set_ref;
+        const PackageRow* row = nullptr;
+        std::vector<DetailField> fields;
+        int value_width = 0;
+        int total_lines = 0;
+    };
+
+    std::list<DetailBlock> detail_blocks_;
+    DetailBlock* detail_block(const PackageList& packages, int idx, int value_width);
+    void build_detail_fields(DetailBlock& block);
+    static void layout_detail_block(DetailBlock& block, int value_width);
+    static void detail_columns(int dw, int& label_width, int& label_col, int& value_width);
+    void prefetch_details(const PackageList& packages);
+
+    const LogBuffer* tail_log_ = nullptr;
+    uint64_t tail_start_ = 0;
+    int tail_top_ = -1;
+    int tail_height_ = 0;
+    void draw_log_tail(const LogBuffer& log, int top, int height);
 
     void draw_search_bar();
-    void draw_package_list(const std::vector<PackageInfo>& packages);
-    void draw_detail_pane(const std::vector<PackageInfo>& packages);
-    void draw_status_bar(const std::vector<PackageInfo>& packages);
+    void draw_package_list(const PackageList& packages);
+    void draw_detail_pane(const PackageList& packages);
+    void draw_status_bar(const PackageList& packages);
     void draw_borders();
 
     const char* accent_fg() const;
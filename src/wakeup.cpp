@@ -0,0 +1,31 @@
+#include "wakeup.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstdint>
+
+namespace pmt {
+
+Wakeup::Wakeup() {
+    fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+Wakeup::~Wakeup() {
+    if (fd_ >= 0) close(fd_);
+}
+
+/* async-signal-safe; repeated notifies before a drain collapse into one wake */
+void Wakeup::notify() {
+    if (fd_ < 0) return;
+    uint64_t one = 1;
+    ssize_t n = write(fd_, &one, sizeof(one));
+    (void)n;
+}
+
+void Wakeup::drain() {
+    if (fd_ < 0) return;
+    uint64_t count;
+    ssize_t n = read(fd_, &count, sizeof(count));
+    (void)n;
+}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace pmt {
+
+/* eventfd that background threads and signal handlers poke to wake the main loop */
+class Wakeup {
+public:
+    Wakeup();
+    ~Wakeup();
+    Wakeup(const Wakeup&) = delete;
+    Wakeup& operator=(const Wakeup&) = delete;
+
+    void notify();
+    void drain();
+    int fd() const { return fd_; }
+
+private:
+    int fd_ = -1;
+};
+
+}